@@ -0,0 +1,25 @@
+#!/usr/bin/env bash
+# BLE benchmark on BabbleSim: the watch and the central of tools/bsim_central on a simulated
+# 2.4 GHz channel. Needs BSIM_OUT_PATH and BSIM_COMPONENTS_PATH from the BabbleSim install.
+#
+# @license GNU v3
+# @maintainer electricalgorithm @ github
+
+set -euo pipefail
+
+: "${BSIM_OUT_PATH:?BabbleSim is not installed, see the README.}"
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+BUILD_DIR="${BUILD_DIR:-${ROOT_DIR}/build_bsim}"
+SIM_ID="zephyrwatch_ble"
+SIM_LENGTH_US="${SIM_LENGTH_US:-120000000}"
+# Extra CMake arguments of the watch, e.g. WATCH_ARGS="-DCONFIG_BT_GATT_CACHING=n".
+WATCH_ARGS="${WATCH_ARGS:-}"
+
+west build -p always -b nrf52_bsim -d "${BUILD_DIR}/watch" "${ROOT_DIR}" -- ${WATCH_ARGS}
+west build -p always -b nrf52_bsim -d "${BUILD_DIR}/central" "${ROOT_DIR}/tools/bsim_central"
+
+cd "${BSIM_OUT_PATH}/bin"
+./bs_2G4_phy_v1 -s="${SIM_ID}" -D=2 -sim_length="${SIM_LENGTH_US}" &
+"${BUILD_DIR}/watch/zephyr/zephyr.exe" -s="${SIM_ID}" -d=0 -RealEncryption=1 &
+"${BUILD_DIR}/central/zephyr/zephyr.exe" -s="${SIM_ID}" -d=1 -RealEncryption=1
+wait
@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+"""Per-subsystem ROM/RAM footprint report for ZephyrWatch.
+
+Parses the GNU ld map file of a build, groups every input section by the subsystem it belongs
+to (LVGL, fonts, BT host, each src/ module, ...) and compares the totals against a committed
+budget file. Exits with an error when a subsystem grows above the budget plus the threshold, or
+when it has no budget at all.
+
+@license GNU v3
+@maintainer electricalgorithm @ github
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+# Output section headers start at the first column, input sections with a single space.
+OUTPUT_SECTION_RE = re.compile(r"^(\.?[\w.$-]+)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+).*)?$")
+INPUT_SECTION_RE = re.compile(r"^ ([\w.$*-]+|COMMON)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*))?$")
+CONTINUATION_RE = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+OBJECT_RE = re.compile(r"\.(?:obj|o)\)?$")
+ARCHIVE_MEMBER_RE = re.compile(r"^(.*)\((.+)\)$")
+
+
+def load_budget(path):
+    with open(path, encoding="utf-8") as budget_file:
+        return json.load(budget_file)
+
+
+def source_modules(source_dir):
+    """Map the object file names of the application to their src/ module."""
+    modules = {}
+    for root, _, files in os.walk(source_dir):
+        for name in files:
+            if not name.endswith(".c"):
+                continue
+            relative = os.path.relpath(os.path.join(root, name), source_dir)
+            parts = relative.split(os.sep)
+            module = parts[0] if len(parts) > 1 else os.path.splitext(name)[0]
+            modules[name + ".obj"] = "app/" + module
+    return modules
+
+
+def section_kind(section, budget):
+    """Return which memories an output section occupies: ROM, RAM or both."""
+    if any(section.startswith(prefix) for prefix in budget["ignore_sections"]):
+        return ()
+    if any(re.search(pattern, section) for pattern in budget["ram_sections"]):
+        return ("ram",)
+    # Initialized data and IRAM code are stored in flash and copied into RAM on boot.
+    if any(re.search(pattern, section) for pattern in budget["ram_and_rom_sections"]):
+        return ("rom", "ram")
+    return ("rom",)
+
+
+def classify(origin, rules, modules):
+    """Find the subsystem of an input section from the object it comes from."""
+    match = ARCHIVE_MEMBER_RE.match(origin)
+    archive, member = (match.group(1), match.group(2)) if match else (origin, os.path.basename(origin))
+    if "libapp.a" in archive and member in modules:
+        return modules[member]
+    for rule in rules:
+        if re.search(rule["match"], origin):
+            return rule["name"]
+    return "other"
+
+
+def parse_map(path, budget, modules):
+    """Sum the input section sizes per subsystem and memory."""
+    totals = {}
+    output_section = None
+    pending_input = None
+    in_memory_map = False
+
+    def account(size, origin):
+        if output_section is None or size == 0 or not OBJECT_RE.search(origin):
+            return
+        subsystem = classify(origin.strip(), budget["rules"], modules)
+        entry = totals.setdefault(subsystem, {"rom": 0, "ram": 0})
+        for memory in section_kind(output_section, budget):
+            entry[memory] += size
+
+    with open(path, encoding="utf-8", errors="replace") as map_file:
+        for line in map_file:
+            line = line.rstrip("\n")
+            if not in_memory_map:
+                in_memory_map = line.startswith("Linker script and memory map")
+                continue
+
+            # The input section name was too long, its address and size are on this line.
+            if pending_input is not None:
+                pending_input = None
+                match = CONTINUATION_RE.match(line)
+                if match:
+                    account(int(match.group(2), 16), match.group(3))
+                    continue
+
+            if line and not line[0].isspace():
+                match = OUTPUT_SECTION_RE.match(line)
+                output_section = match.group(1) if match else None
+                continue
+
+            match = INPUT_SECTION_RE.match(line)
+            if match:
+                if match.group(2) is None:
+                    pending_input = match.group(1)
+                else:
+                    account(int(match.group(3), 16), match.group(4))
+    return totals
+
+
+def compare(totals, budget):
+    """Print the report and return the list of subsystems above their budget or without one."""
+    threshold = budget["threshold_percent"]
+    limits = budget["subsystems"]
+    failures = []
+
+    print(f"{'Subsystem':<28}{'ROM':>10}{'budget':>10}{'RAM':>10}{'budget':>10}")
+    for subsystem in sorted(set(totals) | set(limits)):
+        actual = totals.get(subsystem, {"rom": 0, "ram": 0})
+        limit = limits.get(subsystem, {})
+        row = f"{subsystem:<28}"
+        # A new subsystem has to get its budget, otherwise it could grow unchecked.
+        if subsystem not in limits and (actual["rom"] or actual["ram"]):
+            failures.append(f"{subsystem}: no budget, record it with footprint_update")
+        for memory in ("rom", "ram"):
+            allowed = limit.get(memory)
+            row += f"{actual[memory]:>10}{'-' if allowed is None else allowed:>10}"
+            if allowed is not None and actual[memory] > allowed * (100 + threshold) / 100:
+                failures.append(f"{subsystem} {memory.upper()}: {actual[memory]} > {allowed} (+{threshold}%)")
+        print(row)
+
+    total_rom = sum(entry["rom"] for entry in totals.values())
+    total_ram = sum(entry["ram"] for entry in totals.values())
+    print(f"{'total':<28}{total_rom:>10}{'':>10}{total_ram:>10}")
+    return failures
+
+
+def update_budget(path, budget, totals):
+    budget["subsystems"] = {name: dict(sizes) for name, sizes in sorted(totals.items())}
+    with open(path, "w", encoding="utf-8") as budget_file:
+        json.dump(budget, budget_file, indent=2)
+        budget_file.write("\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--map", required=True, help="linker map file of the build")
+    parser.add_argument("--budget", required=True, help="committed budget file (JSON)")
+    parser.add_argument("--source-dir", required=True, help="application src/ directory")
+    parser.add_argument("--update", action="store_true", help="write the current sizes as the new budget")
+    args = parser.parse_args()
+
+    budget = load_budget(args.budget)
+    totals = parse_map(args.map, budget, source_modules(args.source_dir))
+
+    if args.update:
+        update_budget(args.budget, budget, totals)
+        print(f"Budget is updated: {args.budget}")
+        return 0
+
+    if not budget["subsystems"]:
+        print("No budget is recorded yet, run footprint_update on an esp32s3 build and commit it.",
+              file=sys.stderr)
+        return 1
+
+    failures = compare(totals, budget)
+    if failures:
+        print("Footprint budget exceeded:", file=sys.stderr)
+        for failure in failures:
+            print(f"  {failure}", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
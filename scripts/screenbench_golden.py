@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""Golden image writer for the ZephyrWatch screen benchmark.
+
+Reads the output of a native_sim build with CONFIG_ZW_UI_SCREEN_BENCH_GOLDEN_UPDATE from the
+standard input, and writes the rows printed for each screen into <directory>/<screen>.png. With
+--convert, it turns such a PNG back into the packed RGB565 the benchmark compares the screens
+with; the build runs it for every golden image, so the firmware needs no PNG decoder.
+
+The RGB565 channels are widened to 8 bits by repeating their high bits, so the conversion back
+is exact and the committed PNG can be viewed and diffed like any other image.
+
+@license GNU v3
+@maintainer electricalgorithm @ github
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+import zlib
+
+GOLDEN_ROW_RE = re.compile(r"^golden (\w+) (\d+) ([0-9a-f]+)$")
+PNG_SIGNATURE = b"\x89PNG\r\n\x1a\n"
+
+
+def rgb565_to_rgb888(row):
+    pixels = bytearray()
+    for (pixel,) in struct.iter_unpack("<H", row):
+        red, green, blue = pixel >> 11, (pixel >> 5) & 0x3F, pixel & 0x1F
+        pixels += bytes(((red << 3) | (red >> 2), (green << 2) | (green >> 4), (blue << 3) | (blue >> 2)))
+    return bytes(pixels)
+
+
+def rgb888_to_rgb565(row):
+    pixels = bytearray()
+    for red, green, blue in struct.iter_unpack("BBB", row):
+        pixels += struct.pack("<H", ((red >> 3) << 11) | ((green >> 2) << 5) | (blue >> 3))
+    return bytes(pixels)
+
+
+def png_chunk(kind, data):
+    return struct.pack(">I", len(data)) + kind + data + struct.pack(">I", zlib.crc32(kind + data))
+
+
+def write_png(path, width, rows):
+    """Write 8-bit RGB rows without filtering, zlib does well enough on the flat UI colors."""
+    header = struct.pack(">IIBBBBB", width, len(rows), 8, 2, 0, 0, 0)
+    data = zlib.compress(b"".join(b"\x00" + row for row in rows), 9)
+    with open(path, "wb") as png_file:
+        png_file.write(PNG_SIGNATURE + png_chunk(b"IHDR", header) + png_chunk(b"IDAT", data)
+                       + png_chunk(b"IEND", b""))
+
+
+def unfilter(kind, row, previous, stride):
+    """Undo the PNG filter of a row, in case an image tool has re-encoded the file."""
+    out = bytearray(row)
+    for i in range(len(out)):
+        left = out[i - stride] if i >= stride else 0
+        up = previous[i]
+        up_left = previous[i - stride] if i >= stride else 0
+        if kind == 1:
+            out[i] = (out[i] + left) & 0xFF
+        elif kind == 2:
+            out[i] = (out[i] + up) & 0xFF
+        elif kind == 3:
+            out[i] = (out[i] + ((left + up) >> 1)) & 0xFF
+        elif kind == 4:
+            estimate = left + up - up_left
+            distances = (abs(estimate - left), abs(estimate - up), abs(estimate - up_left))
+            predictor = (left, up, up_left)[distances.index(min(distances))]
+            out[i] = (out[i] + predictor) & 0xFF
+    return bytes(out)
+
+
+def read_png(path):
+    """Return the rows of an 8-bit RGB PNG, the only format the golden images are written in."""
+    with open(path, "rb") as png_file:
+        data = png_file.read()
+    if not data.startswith(PNG_SIGNATURE):
+        raise ValueError(f"{path} is not a PNG")
+    offset, header, compressed = len(PNG_SIGNATURE), None, b""
+    while offset < len(data):
+        (length,) = struct.unpack_from(">I", data, offset)
+        kind = data[offset + 4:offset + 8]
+        body = data[offset + 8:offset + 8 + length]
+        offset += length + 12
+        if kind == b"IHDR":
+            header = struct.unpack(">IIBBBBB", body)
+        elif kind == b"IDAT":
+            compressed += body
+        elif kind == b"IEND":
+            break
+    if header is None or header[2:] != (8, 2, 0, 0, 0):
+        raise ValueError(f"{path} is not an 8-bit RGB PNG without interlacing")
+
+    width, height = header[0], header[1]
+    stride, raw = width * 3, zlib.decompress(compressed)
+    rows, previous = [], bytes(stride)
+    for y in range(height):
+        start = y * (stride + 1)
+        previous = unfilter(raw[start], raw[start + 1:start + 1 + stride], previous, 3)
+        rows.append(previous)
+    return rows
+
+
+def convert(png_path, rgb565_path):
+    rows = read_png(png_path)
+    with open(rgb565_path, "wb") as golden_file:
+        golden_file.write(b"".join(rgb888_to_rgb565(row) for row in rows))
+    return 0
+
+
+def record(directory):
+    screens = {}
+    for line in sys.stdin:
+        match = GOLDEN_ROW_RE.match(line.strip())
+        if match:
+            screens.setdefault(match.group(1), {})[int(match.group(2))] = bytes.fromhex(match.group(3))
+
+    if not screens:
+        print("No golden rows in the input.", file=sys.stderr)
+        return 1
+
+    os.makedirs(directory, exist_ok=True)
+    for screen, rows in sorted(screens.items()):
+        if sorted(rows) != list(range(len(rows))):
+            print(f"Rows of {screen} are missing.", file=sys.stderr)
+            return 1
+        path = os.path.join(directory, f"{screen}.png")
+        write_png(path, len(rows[0]) // 2, [rgb565_to_rgb888(rows[y]) for y in range(len(rows))])
+        print(f"Golden image is updated: {path}")
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("directory", nargs="?", help="directory of the golden images")
+    parser.add_argument("--convert", nargs=2, metavar=("PNG", "RGB565"),
+                        help="convert a golden image to the packed RGB565 of the benchmark")
+    args = parser.parse_args()
+
+    if args.convert:
+        return convert(*args.convert)
+    if args.directory is None:
+        parser.error("the directory of the golden images is required")
+    return record(args.directory)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,141 @@
+/** Benchmark Subsystem for ZephyrWatch.
+ * Implements the metric accumulators used to report performance numbers.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+
+#include "benchmark/benchmark.h"
+#include "storage/storage.h"
+
+LOG_MODULE_REGISTER(ZephyrWatch_Benchmark, CONFIG_ZW_LOG_LEVEL);
+
+// All the metrics which have at least one sample since boot.
+static sys_slist_t metrics = SYS_SLIST_STATIC_INIT(&metrics);
+static struct k_spinlock metrics_lock;
+
+// Periodic reporter of the metrics.
+static void benchmark_report_worker(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(benchmark_report_work, benchmark_report_worker);
+
+/* ENABLE_BENCHMARK_SUBSYSTEM
+ * Start the periodic reporter.
+ */
+int enable_benchmark_subsystem() {
+    k_work_schedule(&benchmark_report_work, K_SECONDS(CONFIG_ZW_BENCHMARK_REPORT_INTERVAL_S));
+    LOG_DBG("Benchmark reporter is scheduled.");
+    return 0;
+}
+
+/* BENCHMARK_METRIC_RECORD
+ * Add a sample to the metric. It only takes a spinlock, so it can be called from ISRs.
+ */
+void benchmark_metric_record(benchmark_metric_t *metric, uint32_t value) {
+    // Register the metric on its first sample.
+    if (!metric->registered) {
+        k_spinlock_key_t key = k_spin_lock(&metrics_lock);
+        if (!metric->registered) {
+            sys_slist_append(&metrics, &metric->node);
+            metric->registered = true;
+        }
+        k_spin_unlock(&metrics_lock, key);
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&metric->lock);
+    metric->count++;
+    metric->sum += value;
+    if (value < metric->min) metric->min = value;
+    if (value > metric->max) metric->max = value;
+    k_spin_unlock(&metric->lock, key);
+}
+
+/* BENCHMARK_METRIC_RESET
+ * Remove all the samples from the metric.
+ */
+void benchmark_metric_reset(benchmark_metric_t *metric) {
+    k_spinlock_key_t key = k_spin_lock(&metric->lock);
+    metric->count = 0;
+    metric->sum = 0;
+    metric->min = UINT32_MAX;
+    metric->max = 0;
+    k_spin_unlock(&metric->lock, key);
+}
+
+/* BENCHMARK_METRIC_AVERAGE
+ * Return the average of the samples.
+ */
+uint32_t benchmark_metric_average(benchmark_metric_t *metric) {
+    k_spinlock_key_t key = k_spin_lock(&metric->lock);
+    uint32_t average = metric->count ? (uint32_t)(metric->sum / metric->count) : 0;
+    k_spin_unlock(&metric->lock, key);
+    return average;
+}
+
+/* BENCHMARK_METRIC_REPORT
+ * Print the metric into the log. Jitter is the distance between the worst and the best sample.
+ */
+void benchmark_metric_report(benchmark_metric_t *metric) {
+    k_spinlock_key_t key = k_spin_lock(&metric->lock);
+    benchmark_metric_t snapshot = *metric;
+    k_spin_unlock(&metric->lock, key);
+
+    if (snapshot.count == 0) {
+        LOG_INF("%s: no samples", snapshot.name);
+        return;
+    }
+    LOG_INF("%s: n=%u min=%u avg=%u max=%u jitter=%u %s", snapshot.name, snapshot.count,
+            snapshot.min, (uint32_t)(snapshot.sum / snapshot.count), snapshot.max,
+            snapshot.max - snapshot.min, snapshot.unit);
+}
+
+/* BENCHMARK_REPORT_ALL
+ * Print every registered metric, and reset them to measure the next period.
+ */
+void benchmark_report_all() {
+    benchmark_metric_t *metric;
+    SYS_SLIST_FOR_EACH_CONTAINER(&metrics, metric, node) {
+        benchmark_metric_report(metric);
+        benchmark_metric_reset(metric);
+    }
+}
+
+/* BENCHMARK_REPORT_WORKER
+ * Print the metrics and reschedule itself.
+ */
+static void benchmark_report_worker(struct k_work *work) {
+    benchmark_report_all();
+    k_work_schedule(&benchmark_report_work, K_SECONDS(CONFIG_ZW_BENCHMARK_REPORT_INTERVAL_S));
+}
+
+#if defined(CONFIG_ZW_FLASH_STRESS)
+/* FLASH_STRESS_THREAD
+ * Keep committing a scratch settings entry, so the flash is written continuously as it is in
+ * NVS commits or OTA updates. Latencies measured meanwhile show the cost of the cache stalls.
+ */
+static void flash_stress_thread(void *p1, void *p2, void *p3) {
+    uint32_t counter = 0;
+
+    int ret = settings_subsys_init();
+    if (ret) {
+        LOG_ERR("Settings subsystem couldn't be initialized. (RET: %d)", ret);
+        return;
+    }
+    LOG_INF("Flash stress is started.");
+
+    while (1) {
+        counter++;
+        ret = settings_save_one("zw/bench/stress", &counter, sizeof(counter));
+        // The deferred store would merge the writes, they have to reach the flash.
+        if (IS_ENABLED(CONFIG_ZW_STORAGE)) storage_flush();
+        if (ret) LOG_ERR("Flash stress write failed. (RET: %d)", ret);
+        k_sleep(K_MSEC(CONFIG_ZW_FLASH_STRESS_INTERVAL_MS));
+    }
+}
+
+K_THREAD_DEFINE(flash_stress_tid, 2048, flash_stress_thread, NULL, NULL, NULL,
+                K_LOWEST_APPLICATION_THREAD_PRIO, 0, 5000);
+#endif
@@ -0,0 +1,77 @@
+/** Benchmark Subsystem for ZephyrWatch.
+ * Provides lightweight min/max/average accumulators that other subsystems use to report
+ * performance numbers (latencies, throughputs, cycle counts) through the logger. Each metric
+ * registers itself on its first sample, and all of them are printed periodically.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#ifndef _BENCHMARK_H
+#define _BENCHMARK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/kernel.h>
+#include <zephyr/spinlock.h>
+#include <zephyr/sys/slist.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A single named metric. Safe to record from ISRs. */
+typedef struct {
+    sys_snode_t node;
+    bool registered;
+    const char *name;
+    const char *unit;
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    struct k_spinlock lock;
+} benchmark_metric_t;
+
+/* Define and initialize a metric with a name and an unit to be printed. */
+#define BENCHMARK_METRIC_DEFINE(_var, _name, _unit) \
+    benchmark_metric_t _var = { .name = (_name), .unit = (_unit), .min = UINT32_MAX }
+
+/* Run the statement and record the CPU cycles it took into the metric. */
+#define BENCHMARK_CYCLES(_metric, _statement)                               \
+    do {                                                                    \
+        uint32_t _benchmark_start = k_cycle_get_32();                       \
+        _statement;                                                         \
+        benchmark_metric_record((_metric), k_cycle_get_32() - _benchmark_start); \
+    } while (0)
+
+/* Record the cycles of the log statement into the metric when CONFIG_ZW_LOG_CYCLE_STATS is set. */
+#if defined(CONFIG_ZW_LOG_CYCLE_STATS)
+#define BENCHMARK_LOG_CALL(_var, _log_statement) BENCHMARK_CYCLES(&(_var), _log_statement)
+#else
+#define BENCHMARK_LOG_CALL(_var, _log_statement) _log_statement
+#endif
+
+/* Start printing the recorded metrics periodically. */
+int enable_benchmark_subsystem();
+
+/* Record a new sample to the metric. */
+void benchmark_metric_record(benchmark_metric_t *metric, uint32_t value);
+
+/* Clear all the samples of the metric. */
+void benchmark_metric_reset(benchmark_metric_t *metric);
+
+/* Get the average of the recorded samples, 0 if there is none. */
+uint32_t benchmark_metric_average(benchmark_metric_t *metric);
+
+/* Print the metric as "name: count/min/avg/max/jitter unit" to the logger. */
+void benchmark_metric_report(benchmark_metric_t *metric);
+
+/* Print all the registered metrics and reset them. */
+void benchmark_report_all();
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
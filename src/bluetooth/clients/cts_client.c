@@ -0,0 +1,314 @@
+/** Current Time Service (CTS) client implementation.
+ * When the link to the phone gets encrypted, the Current Time characteristic of the phone is read
+ * and the watch is set to it, and its notifications are subscribed to. The handles found by the
+ * service discovery are cached per peer identity, so on every reconnect of a known phone the time
+ * is corrected with a single GATT read. Phones without the service are cached as well, to not
+ * discover them again.
+ *
+ * @license: GNU v3
+ * @maintainer: electricalgorithm @ github
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#include "benchmark/benchmark.h"
+#include "bluetooth/clients/cts_client.h"
+#include "bluetooth/infrastructure.h"
+#include "bluetooth/services/current_time_service.h"
+#include "datetime/datetime.h"
+#include "devicetwin/devicetwin.h"
+
+LOG_MODULE_REGISTER(ZephyrWatch_BLE_CTSClient, CONFIG_ZW_LOG_LEVEL);
+
+/* Handles of the Current Time characteristic of a peer. A zero value handle means that the peer
+ * has no Current Time Service.
+ */
+typedef struct {
+    bool valid;
+    bt_addr_le_t peer;
+    uint16_t value_handle;
+    uint16_t ccc_handle;
+    uint32_t last_used;
+} cts_handle_cache_t;
+
+static cts_handle_cache_t handle_cache[CONFIG_BT_MAX_PAIRED];
+static uint32_t cache_clock;
+
+// State of the connection the client works on.
+static struct bt_conn *client_conn;
+static cts_handle_cache_t *active_entry;
+static uint16_t service_end_handle;
+static struct bt_uuid_16 discover_uuid = BT_UUID_INIT_16(0);
+static struct bt_gatt_discover_params discover_params;
+static struct bt_gatt_read_params read_params;
+static struct bt_gatt_subscribe_params subscribe_params;
+
+#if defined(CONFIG_ZW_BLE_STATS)
+// Time from the encryption of the link until the time is set, with and without discovery.
+static BENCHMARK_METRIC_DEFINE(sync_time_discovered, "CTS client sync with discovery", "ms");
+static BENCHMARK_METRIC_DEFINE(sync_time_cached, "CTS client sync with cached handles", "ms");
+static int64_t sync_start_ms;
+static bool sync_discovered;
+#endif
+
+/* CTS_CLIENT_PARSE_CURRENT_TIME
+ * The value starts with the Exact Time 256: year (LE16), month, day, hours, minutes, seconds,
+ * day of week (1 is Monday, 7 is Sunday) and fractions, followed by the adjust reason.
+ */
+int cts_client_parse_current_time(const uint8_t *buf, uint16_t len, datetime_t *local_time) {
+    if (len < CTS_CURRENT_TIME_LENGTH) {
+        return -EINVAL;
+    }
+
+    local_time->year = sys_get_le16(buf);
+    local_time->month = buf[2];
+    local_time->day = buf[3];
+    local_time->hour = buf[4];
+    local_time->minute = buf[5];
+    local_time->second = buf[6];
+    local_time->weekday = buf[7] % 7;
+
+    // Zero year, month or day means unknown.
+    if (local_time->year == 0 || local_time->month == 0 || local_time->day == 0) {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+/* CACHE_FIND
+ * Return the cache entry of the peer, or NULL.
+ */
+static cts_handle_cache_t *cache_find(const bt_addr_le_t *peer) {
+    for (int i = 0; i < ARRAY_SIZE(handle_cache); i++) {
+        if (handle_cache[i].valid && bt_addr_le_eq(&handle_cache[i].peer, peer)) {
+            handle_cache[i].last_used = ++cache_clock;
+            return &handle_cache[i];
+        }
+    }
+    return NULL;
+}
+
+/* CACHE_ALLOCATE
+ * Return a free entry for the peer, or the least recently used one.
+ */
+static cts_handle_cache_t *cache_allocate(const bt_addr_le_t *peer) {
+    cts_handle_cache_t *entry = &handle_cache[0];
+    for (int i = 0; i < ARRAY_SIZE(handle_cache); i++) {
+        if (!handle_cache[i].valid) {
+            entry = &handle_cache[i];
+            break;
+        }
+        if (handle_cache[i].last_used < entry->last_used) {
+            entry = &handle_cache[i];
+        }
+    }
+
+    *entry = (cts_handle_cache_t){ .last_used = ++cache_clock };
+    bt_addr_le_copy(&entry->peer, peer);
+    return entry;
+}
+
+/* APPLY_CURRENT_TIME
+ * Set the watch to the time of the phone. The phone sends its local time, which is converted
+ * with the time zone of the watch.
+ */
+static void apply_current_time(const uint8_t *data, uint16_t length) {
+    datetime_t local_time;
+    if (cts_client_parse_current_time(data, length, &local_time)) {
+        LOG_WRN("Invalid current time from the peer (%u bytes).", length);
+        return;
+    }
+
+    device_twin_t *device_twin = get_device_twin_instance();
+    uint32_t unix_time = datetime_to_unix(&local_time, device_twin->utc_zone);
+    if (unix_time == 0) {
+        LOG_WRN("The current time of the peer is out of range.");
+        return;
+    }
+    set_current_unix_time(unix_time);
+    device_twin->last_time_sync = unix_time;
+    if (IS_ENABLED(CONFIG_ZW_USERINTERFACE)) trigger_ui_update();
+    if (IS_ENABLED(CONFIG_ZW_BLE_STATUS_BROADCAST)) bluetooth_status_changed();
+    LOG_INF("Current time read from the peer: UNIX %u.", unix_time);
+
+#if defined(CONFIG_ZW_BLE_STATS)
+    if (sync_start_ms) {
+        benchmark_metric_record(sync_discovered ? &sync_time_discovered : &sync_time_cached,
+                                (uint32_t)(k_uptime_get() - sync_start_ms));
+        sync_start_ms = 0;
+    }
+#endif
+}
+
+static uint8_t process_notification(struct bt_conn *conn, struct bt_gatt_subscribe_params *params,
+                                    const void *data, uint16_t length) {
+    if (data == NULL) {
+        LOG_DBG("Unsubscribed from the current time.");
+        params->value_handle = 0;
+        return BT_GATT_ITER_STOP;
+    }
+    apply_current_time(data, length);
+    return BT_GATT_ITER_CONTINUE;
+}
+
+static uint8_t process_read(struct bt_conn *conn, uint8_t err, struct bt_gatt_read_params *params,
+                            const void *data, uint16_t length) {
+    if (err) {
+        // The handles are stale (e.g. the phone was updated), discover again on the next link.
+        LOG_WRN("Reading the current time failed (err 0x%02x), dropping the cached handles.", err);
+        if (active_entry) active_entry->valid = false;
+        return BT_GATT_ITER_STOP;
+    }
+    if (data != NULL) {
+        apply_current_time(data, length);
+    }
+    return BT_GATT_ITER_STOP;
+}
+
+/* READ_AND_SUBSCRIBE
+ * Read the current time with the known handles and subscribe to its changes.
+ */
+static void read_and_subscribe() {
+    read_params.func = process_read;
+    read_params.handle_count = 1;
+    read_params.single.handle = active_entry->value_handle;
+    read_params.single.offset = 0;
+    int err = bt_gatt_read(client_conn, &read_params);
+    if (err) {
+        LOG_ERR("Failed to read the current time (err %d).", err);
+        return;
+    }
+
+    if (active_entry->ccc_handle == 0) return;
+    subscribe_params.notify = process_notification;
+    subscribe_params.value = BT_GATT_CCC_NOTIFY;
+    subscribe_params.value_handle = active_entry->value_handle;
+    subscribe_params.ccc_handle = active_entry->ccc_handle;
+    atomic_set_bit(subscribe_params.flags, BT_GATT_SUBSCRIBE_FLAG_VOLATILE);
+    err = bt_gatt_subscribe(client_conn, &subscribe_params);
+    if (err && err != -EALREADY) {
+        LOG_ERR("Failed to subscribe to the current time (err %d).", err);
+    }
+}
+
+/* PROCESS_DISCOVERY
+ * Find the service, then the characteristic, then its CCC descriptor.
+ */
+static uint8_t process_discovery(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                                 struct bt_gatt_discover_params *params) {
+    if (attr == NULL) {
+        // Not found: no service means no CTS on the peer, no CCC means no notifications.
+        if (params->type != BT_GATT_DISCOVER_DESCRIPTOR) {
+            LOG_INF("The peer has no Current Time Service.");
+            active_entry->value_handle = 0;
+            active_entry->valid = true;
+            return BT_GATT_ITER_STOP;
+        }
+        active_entry->valid = true;
+        read_and_subscribe();
+        return BT_GATT_ITER_STOP;
+    }
+
+    int err = 0;
+    switch (params->type) {
+    case BT_GATT_DISCOVER_PRIMARY: {
+        const struct bt_gatt_service_val *service = attr->user_data;
+        service_end_handle = service->end_handle;
+        memcpy(&discover_uuid, BT_UUID_CTS_CURRENT_TIME, sizeof(discover_uuid));
+        params->start_handle = attr->handle + 1;
+        params->end_handle = service_end_handle;
+        params->type = BT_GATT_DISCOVER_CHARACTERISTIC;
+        err = bt_gatt_discover(conn, params);
+        break;
+    }
+    case BT_GATT_DISCOVER_CHARACTERISTIC: {
+        const struct bt_gatt_chrc *chrc = attr->user_data;
+        active_entry->value_handle = chrc->value_handle;
+        if (!(chrc->properties & BT_GATT_CHRC_NOTIFY) || chrc->value_handle >= service_end_handle) {
+            active_entry->valid = true;
+            read_and_subscribe();
+            return BT_GATT_ITER_STOP;
+        }
+        memcpy(&discover_uuid, BT_UUID_GATT_CCC, sizeof(discover_uuid));
+        params->start_handle = chrc->value_handle + 1;
+        params->end_handle = service_end_handle;
+        params->type = BT_GATT_DISCOVER_DESCRIPTOR;
+        err = bt_gatt_discover(conn, params);
+        break;
+    }
+    case BT_GATT_DISCOVER_DESCRIPTOR:
+        active_entry->ccc_handle = attr->handle;
+        active_entry->valid = true;
+        read_and_subscribe();
+        break;
+    default:
+        break;
+    }
+
+    if (err) {
+        LOG_ERR("Current Time Service discovery failed (err %d).", err);
+    }
+    return BT_GATT_ITER_STOP;
+}
+
+/* START_DISCOVERY
+ * Look for the Current Time Service of the peer.
+ */
+static void start_discovery() {
+    memcpy(&discover_uuid, BT_UUID_CTS, sizeof(discover_uuid));
+    discover_params.uuid = &discover_uuid.uuid;
+    discover_params.func = process_discovery;
+    discover_params.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+    discover_params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+    discover_params.type = BT_GATT_DISCOVER_PRIMARY;
+
+    int err = bt_gatt_discover(client_conn, &discover_params);
+    if (err) {
+        LOG_ERR("Failed to start the Current Time Service discovery (err %d).", err);
+    }
+}
+
+static void process_security_changed(struct bt_conn *conn, bt_security_t level, enum bt_security_err err) {
+    if (err || level < BT_SECURITY_L2 || client_conn != NULL) return;
+    client_conn = bt_conn_ref(conn);
+
+#if defined(CONFIG_ZW_BLE_STATS)
+    sync_start_ms = k_uptime_get();
+#endif
+
+    const bt_addr_le_t *peer = bt_conn_get_dst(conn);
+    active_entry = cache_find(peer);
+#if defined(CONFIG_ZW_BLE_STATS)
+    sync_discovered = active_entry == NULL;
+#endif
+    if (active_entry == NULL) {
+        active_entry = cache_allocate(peer);
+        start_discovery();
+        return;
+    }
+    if (active_entry->value_handle == 0) {
+        LOG_DBG("The peer is known to have no Current Time Service.");
+        return;
+    }
+    LOG_DBG("Using the cached Current Time handles.");
+    read_and_subscribe();
+}
+
+static void process_disconnection(struct bt_conn *conn, uint8_t reason) {
+    if (conn != client_conn) return;
+    bt_conn_unref(client_conn);
+    client_conn = NULL;
+    active_entry = NULL;
+}
+
+BT_CONN_CB_DEFINE(cts_client_callbacks) = {
+    .security_changed = process_security_changed,
+    .disconnected = process_disconnection,
+};
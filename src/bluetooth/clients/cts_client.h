@@ -0,0 +1,31 @@
+/** Current Time Service (CTS) client interface.
+ * Reads the time from the Current Time Service of the phone once the link is encrypted, and keeps
+ * it in sync with the notifications of the phone.
+ *
+ * @license: GNU v3
+ * @maintainer: electricalgorithm @ github
+ */
+
+#ifndef CTS_CLIENT_H
+#define CTS_CLIENT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "datetime/datetime.h"
+
+/* Length of the Current Time characteristic: Exact Time 256 and the adjust reason. */
+#define CTS_CURRENT_TIME_LENGTH 10
+
+/* Parse the Current Time characteristic value of the peer into local time. Returns 0, or
+ * -EINVAL if the value is too short or the date is unknown (zero fields).
+ */
+int cts_client_parse_current_time(const uint8_t *buf, uint16_t len, datetime_t *local_time);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CTS_CLIENT_H
@@ -5,17 +5,50 @@
  * @maintainer: electricalgorithm @ github 
  */
 
+#include "benchmark/benchmark.h"
+#include "devicetwin/devicetwin.h"
+#include "power/power.h"
 #include "userinterface/screens/blepairing/blepairing.h"
 #include "zephyr/bluetooth/conn.h"
 #include <zephyr/settings/settings.h>
 #include <zephyr/bluetooth/gatt.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
 
-LOG_MODULE_REGISTER(ZephyrWatch_BLE, LOG_LEVEL_INF);
+LOG_MODULE_REGISTER(ZephyrWatch_BLE, CONFIG_ZW_LOG_LEVEL);
+
+#if defined(CONFIG_ZW_BLE_STATS)
+// Connection latencies in milliseconds, measured on the watch side.
+static BENCHMARK_METRIC_DEFINE(pairing_time, "BLE pairing time", "ms");
+static BENCHMARK_METRIC_DEFINE(reconnect_time, "BLE reconnect time", "ms");
+static BENCHMARK_METRIC_DEFINE(first_write_time, "BLE connection to first write", "ms");
+static int64_t connected_at_ms;
+static int64_t disconnected_at_ms;
+static bool first_write_pending;
+#endif
+
+#if defined(CONFIG_ZW_BLE_STATUS_BROADCAST)
+// Manufacturer data with the status: company ID (LE16), format version, battery level, steps
+// (LE32) and flags. It fits the legacy advertising, so every phone can read it from a scan.
+#define STATUS_COMPANY_ID CONFIG_ZW_BLE_STATUS_COMPANY_ID
+#define STATUS_FORMAT_VERSION 1
+#define STATUS_FLAG_NEEDS_TIME_SYNC BIT(0)
+#define STATUS_DATA_LENGTH 10
+
+static uint8_t status_data[STATUS_DATA_LENGTH];
+static void status_update_worker(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(status_update_work, status_update_worker);
+#endif
 
 static const struct bt_data m_ad[] = {
     BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
+#if defined(CONFIG_ZW_BLE_CTS)
     BT_DATA_BYTES(BT_DATA_UUID16_ALL, BT_UUID_16_ENCODE(BT_UUID_CTS_VAL)),
+#endif
+#if defined(CONFIG_ZW_BLE_STATUS_BROADCAST)
+    BT_DATA(BT_DATA_MANUFACTURER_DATA, status_data, sizeof(status_data)),
+#endif
 };
 
 static const struct bt_data m_sd[] = {
@@ -29,6 +62,7 @@ static void start_advertisement() {
         return;
     }
     LOG_DBG("Advertising successfully started.");
+    if (IS_ENABLED(CONFIG_ZW_POWER)) power_state_set(POWER_DOMAIN_RADIO, POWER_STATE_RADIO_ADVERTISING);
 }
 
 static void process_connection(struct bt_conn *conn, uint8_t err) {
@@ -37,13 +71,84 @@ static void process_connection(struct bt_conn *conn, uint8_t err) {
         char addr[BT_ADDR_LE_STR_LEN];
         bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
         LOG_INF("Connection established to %s.", addr);
+        if (IS_ENABLED(CONFIG_ZW_POWER)) power_state_set(POWER_DOMAIN_RADIO, POWER_STATE_RADIO_CONNECTED);
+#if defined(CONFIG_ZW_BLE_STATS)
+        // Time from the last disconnection until the peer is back, including the advertising.
+        connected_at_ms = k_uptime_get();
+        first_write_pending = true;
+        if (disconnected_at_ms) {
+            benchmark_metric_record(&reconnect_time, (uint32_t)(connected_at_ms - disconnected_at_ms));
+        }
+#endif
     }
 }
 
 static void process_disconnection(struct bt_conn *conn, uint8_t reason) {
     LOG_INF("Disconnected (reason 0x%02x).", reason);
+#if defined(CONFIG_ZW_BLE_STATS)
+    disconnected_at_ms = k_uptime_get();
+#endif
+}
+
+#if defined(CONFIG_ZW_BLE_STATS)
+/* BLUETOOTH_NOTE_APPLICATION_WRITE
+ * Record the time from the connection until the first write to a service of the watch. A phone
+ * which has to discover the GATT table again spends that time before it can write.
+ */
+void bluetooth_note_application_write() {
+    if (!first_write_pending) return;
+    first_write_pending = false;
+    benchmark_metric_record(&first_write_time, (uint32_t)(k_uptime_get() - connected_at_ms));
+}
+#endif
+
+#if defined(CONFIG_ZW_BLE_STATUS_BROADCAST)
+/* ENCODE_STATUS
+ * Write the status of the device twin into the buffer. The time sync is needed when the phone
+ * has never set the time, or not for a while.
+ */
+static void encode_status(uint8_t *buf) {
+    device_twin_t *device_twin = get_device_twin_instance();
+    uint8_t flags = 0;
+    if (device_twin->last_time_sync == 0 ||
+        device_twin->unix_time - device_twin->last_time_sync > CONFIG_ZW_BLE_STATUS_SYNC_AGE_H * 3600U) {
+        flags |= STATUS_FLAG_NEEDS_TIME_SYNC;
+    }
+
+    sys_put_le16(STATUS_COMPANY_ID, buf);
+    buf[2] = STATUS_FORMAT_VERSION;
+    buf[3] = device_twin->battery_level;
+    sys_put_le32(device_twin->step_count, buf + 4);
+    buf[8] = flags;
+    buf[9] = 0;
 }
 
+/* STATUS_UPDATE_WORKER
+ * Update the advertising data if the status changed, and check it again later. While connected,
+ * the advertising is stopped and the new data is used when it starts again.
+ */
+static void status_update_worker(struct k_work *work) {
+    uint8_t new_status[STATUS_DATA_LENGTH];
+    encode_status(new_status);
+    if (memcmp(new_status, status_data, sizeof(status_data)) != 0) {
+        memcpy(status_data, new_status, sizeof(status_data));
+        int err = bt_le_adv_update_data(m_ad, ARRAY_SIZE(m_ad), m_sd, ARRAY_SIZE(m_sd));
+        if (err && err != -EAGAIN) {
+            LOG_ERR("Failed to update the advertising data (err %d).", err);
+        }
+        LOG_DBG("Advertised status is updated.");
+    }
+    k_work_schedule(&status_update_work, K_SECONDS(CONFIG_ZW_BLE_STATUS_INTERVAL_S));
+}
+
+/* BLUETOOTH_STATUS_CHANGED
+ * Run the status check now instead of at the next interval.
+ */
+void bluetooth_status_changed() {
+    k_work_reschedule(&status_update_work, K_NO_WAIT);
+}
+#endif
+
 BT_CONN_CB_DEFINE(connection_callbacks) = {
     .connected = process_connection,
     .disconnected = process_disconnection,
@@ -59,10 +164,10 @@ char* passkey_to_string(const unsigned int passkey) {
 static void process_passkey_display(struct bt_conn *conn, unsigned int passkey){
     char addr[BT_ADDR_LE_STR_LEN] = {0};
     // Write PIN to the screen.
-    blepairing_screen_init();
-    blepairing_screen_set_pin(passkey_to_string(passkey));
-    blepairing_screen_load();
-    LOG_DBG("Displaying passkey on the screen.");
+    if (IS_ENABLED(CONFIG_ZW_UI_BLEPAIRING)) {
+        blepairing_screen_show(passkey_to_string(passkey));
+        LOG_DBG("Displaying passkey on the screen.");
+    }
 
     bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
     LOG_DBG("Passkey for %s: %06u", addr, passkey);
@@ -72,18 +177,22 @@ static void process_auth_cancel(struct bt_conn *conn){
     char addr[BT_ADDR_LE_STR_LEN];
     bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
     LOG_DBG("Pairing cancelled: %s", addr);
-    blepairing_screen_unload();
+    if (IS_ENABLED(CONFIG_ZW_UI_BLEPAIRING)) blepairing_screen_unload();
 }
 
 static void process_pairing_complete(struct bt_conn *conn, bool bonded) {
     LOG_DBG("Pairing complete. Bonded: %s", bonded ? "OK" : "FAILURE");
-    blepairing_screen_unload();
+#if defined(CONFIG_ZW_BLE_STATS)
+    // Time from the connection until the keys are exchanged, including the passkey entry.
+    benchmark_metric_record(&pairing_time, (uint32_t)(k_uptime_get() - connected_at_ms));
+#endif
+    if (IS_ENABLED(CONFIG_ZW_UI_BLEPAIRING)) blepairing_screen_unload();
 }
 
 static void process_pairing_failed(struct bt_conn *conn, enum bt_security_err reason) {
     LOG_DBG("Pairing failed. Reason: 0x%02x", reason);
     bt_conn_disconnect(conn, BT_HCI_ERR_AUTH_FAIL);
-    blepairing_screen_unload();
+    if (IS_ENABLED(CONFIG_ZW_UI_BLEPAIRING)) blepairing_screen_unload();
 }
 
 static struct bt_conn_auth_info_cb auth_info_callbacks = {
@@ -108,16 +217,28 @@ uint8_t enable_bluetooth_subsystem() {
     }
     LOG_DBG("Bluetooth initialized.");
 
-    err = bt_unpair(BT_ID_DEFAULT, BT_ADDR_LE_ANY);
+#if defined(CONFIG_ZW_BLE_FIXED_PASSKEY)
+    // Nobody reads the screen in the simulated benchmarks, the central knows the passkey.
+    err = bt_passkey_set(CONFIG_ZW_BLE_FIXED_PASSKEY_VALUE);
     if (err) {
-        LOG_ERR("Unpairing failed (err %d).", err);
+        LOG_ERR("Failed to set the fixed passkey (err %d).", err);
     }
-    LOG_DBG("Unpairing successful.");
+#endif
 
+    // Load the bonds and the GATT database hash, so bonded phones skip the discovery.
     if (IS_ENABLED(CONFIG_SETTINGS)) {
         settings_load();
     }
 
+    // The bonds are only in RAM after they are loaded, they can be removed from now on.
+    if (IS_ENABLED(CONFIG_ZW_BLE_UNPAIR_ON_BOOT)) {
+        err = bt_unpair(BT_ID_DEFAULT, BT_ADDR_LE_ANY);
+        if (err) {
+            LOG_ERR("Unpairing failed (err %d).", err);
+        }
+        LOG_DBG("Unpairing successful.");
+    }
+
     err = bt_conn_auth_cb_register(&auth_callbacks);
     if (err) {
         LOG_ERR("Failed to register authentication callbacks (err %d).", err);
@@ -132,6 +253,12 @@ uint8_t enable_bluetooth_subsystem() {
     }
     LOG_DBG("Authentication information callback registered successfully.");
 
+#if defined(CONFIG_ZW_BLE_STATUS_BROADCAST)
+    // The first advertisement carries the status already.
+    encode_status(status_data);
+    k_work_schedule(&status_update_work, K_SECONDS(CONFIG_ZW_BLE_STATUS_INTERVAL_S));
+#endif
+
     start_advertisement();
     return 0;
 }
@@ -152,5 +279,6 @@ uint8_t disable_bluetooth_subsystem() {
         return err;
     }
     LOG_DBG("Bluetooth disabled.");
+    if (IS_ENABLED(CONFIG_ZW_POWER)) power_state_set(POWER_DOMAIN_RADIO, POWER_STATE_OFF);
     return 0;
 }
\ No newline at end of file
@@ -19,6 +19,14 @@ extern "C" {
 uint8_t enable_bluetooth_subsystem();
 uint8_t disable_bluetooth_subsystem();
 
+/* Record the first write of the phone to a service after the connection (CONFIG_ZW_BLE_STATS). */
+void bluetooth_note_application_write();
+
+/* Refresh the status in the advertising data now (CONFIG_ZW_BLE_STATUS_BROADCAST). It is also
+ * refreshed periodically, the advertising data is only updated when the status changed.
+ */
+void bluetooth_status_changed();
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,91 @@
+/** Calendar Sync Service implementation.
+ * The commands are applied to the calendar subsystem in the write callback. Reading the
+ * characteristic gives the number of the events and the room left, so the phone knows when to
+ * stop sending the far ones.
+ *
+ * @license: GNU v3
+ * @maintainer: electricalgorithm @ github
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#include "bluetooth/services/calendar_service.h"
+#include "calendar/calendar.h"
+
+LOG_MODULE_REGISTER(ZephyrWatch_BLE_Calendar, CONFIG_ZW_LOG_LEVEL);
+
+#define BT_UUID_CALENDAR_VAL BT_UUID_128_ENCODE(0x7a770101, 0x5a57, 0x4e8a, 0x9c1e, 0x3f2b6d0a1c00)
+#define BT_UUID_CALENDAR_EVENTS_VAL BT_UUID_128_ENCODE(0x7a770102, 0x5a57, 0x4e8a, 0x9c1e, 0x3f2b6d0a1c00)
+#define BT_UUID_CALENDAR BT_UUID_DECLARE_128(BT_UUID_CALENDAR_VAL)
+#define BT_UUID_CALENDAR_EVENTS BT_UUID_DECLARE_128(BT_UUID_CALENDAR_EVENTS_VAL)
+
+/* PUT_EVENT
+ * Parse a put command into an event. A longer title is cut.
+ */
+static ssize_t put_event(const uint8_t *data, uint16_t len) {
+    if (len < CALENDAR_PUT_HEADER_LENGTH) return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+
+    calendar_event_t event = {
+        .id = sys_get_le16(data + 1),
+        .start = sys_get_le32(data + 3),
+        .duration_min = sys_get_le16(data + 7),
+        .reminder_min = data[9],
+    };
+    size_t title_length = MIN(len - CALENDAR_PUT_HEADER_LENGTH, CALENDAR_TITLE_MAX - 1);
+    memcpy(event.title, data + CALENDAR_PUT_HEADER_LENGTH, title_length);
+
+    if (calendar_put(&event) == -ENOMEM) return BT_GATT_ERR(BT_ATT_ERR_INSUFFICIENT_RESOURCES);
+    LOG_DBG("Event %u is put at %u.", event.id, event.start);
+    return len;
+}
+
+/* Events characteristic write callback */
+static ssize_t write_events(struct bt_conn *conn, const struct bt_gatt_attr *attr, const void *buf,
+                            uint16_t len, uint16_t offset, uint8_t flags) {
+    const uint8_t *data = buf;
+    if (offset != 0) return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    if (len < 1) return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+
+    switch (data[0]) {
+    case CALENDAR_CMD_PUT:
+        return put_event(data, len);
+    case CALENDAR_CMD_REMOVE:
+        if (len != 3) return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+        // Removing an unknown event is not an error, the phone may retry a lost write.
+        calendar_remove(sys_get_le16(data + 1));
+        return len;
+    case CALENDAR_CMD_CLEAR:
+        if (len != 1) return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+        calendar_clear();
+        return len;
+    default:
+        return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+    }
+}
+
+/* Events characteristic read callback: count LE16, room left LE16. */
+static ssize_t read_events(struct bt_conn *conn, const struct bt_gatt_attr *attr, void *buf,
+                           uint16_t len, uint16_t offset) {
+    uint8_t value[4];
+    size_t count = calendar_count();
+    sys_put_le16(count, value);
+    sys_put_le16(CONFIG_ZW_CALENDAR_EVENTS - count, value + 2);
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, value, sizeof(value));
+}
+
+/* Calendar Sync Service Declaration */
+BT_GATT_SERVICE_DEFINE(calendar_svc,
+    BT_GATT_PRIMARY_SERVICE(BT_UUID_CALENDAR),
+    BT_GATT_CHARACTERISTIC(
+        BT_UUID_CALENDAR_EVENTS,
+        BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+        BT_GATT_PERM_READ_ENCRYPT | BT_GATT_PERM_WRITE_ENCRYPT,
+        read_events, write_events, NULL
+    ),
+);
@@ -0,0 +1,28 @@
+/** Calendar Sync Service interface.
+ * GATT service the phone keeps the calendar of the watch up to date with. Every write to the
+ * events characteristic is one command, the events are identified by a number the phone chooses.
+ *
+ * @license: GNU v3
+ * @maintainer: electricalgorithm @ github
+ */
+
+#ifndef CALENDAR_SERVICE_H
+#define CALENDAR_SERVICE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Commands written to the events characteristic. */
+#define CALENDAR_CMD_PUT 0x01    // id LE16, start LE32, duration (min) LE16, reminder (min), title.
+#define CALENDAR_CMD_REMOVE 0x02 // id LE16
+#define CALENDAR_CMD_CLEAR 0x03
+
+/* Length of a put command without the title. */
+#define CALENDAR_PUT_HEADER_LENGTH 10
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -11,10 +11,37 @@
 #include <string.h>
 
 #include "current_time_service.h"
+#include "bluetooth/infrastructure.h"
+#include "benchmark/benchmark.h"
 #include "datetime/datetime.h"
 #include "devicetwin/devicetwin.h"
 
-LOG_MODULE_REGISTER(ZephyrWatch_BLE_CTS, LOG_LEVEL_INF);
+LOG_MODULE_REGISTER(ZephyrWatch_BLE_CTS, CONFIG_ZW_LOG_LEVEL);
+
+#if defined(CONFIG_ZW_LOG_CYCLE_STATS)
+// Cost of the log call in the write callback, which runs in the BT RX thread.
+static BENCHMARK_METRIC_DEFINE(time_write_log_cycles, "CTS write log call", "cycles");
+#endif
+
+#if defined(CONFIG_ZW_BLE_STATS)
+// Time spent in the write callback, the central sees it as part of the write latency.
+static BENCHMARK_METRIC_DEFINE(time_write_handling, "CTS write handling", "us");
+#endif
+
+/* CTS_PARSE_CURRENT_TIME
+ * Parse the little-endian UNIX timestamp written by the peer. The buffer comes straight from the
+ * ATT PDU and has no alignment, so it is read byte by byte.
+ */
+int cts_parse_current_time(const void *buf, uint16_t len, uint16_t offset, uint32_t *unix_time) {
+    if (offset != 0) {
+        return BT_ATT_ERR_INVALID_OFFSET;
+    }
+    if (len != sizeof(uint32_t)) {
+        return BT_ATT_ERR_INVALID_ATTRIBUTE_LEN;
+    }
+    *unix_time = sys_get_le32(buf);
+    return 0;
+}
 
 /* Current Time Service Write Callback */
 static ssize_t m_time_write_callback(
@@ -24,15 +51,18 @@ static ssize_t m_time_write_callback(
     uint16_t len,
     uint16_t offset,
     uint8_t flags) {
+#if defined(CONFIG_ZW_BLE_STATS)
+    uint32_t start_cycles = k_cycle_get_32();
+    bluetooth_note_application_write();
+#endif
 
-    // Check if we received exactly 4 bytes for UNIX timestamp
-    if (len != 4 || offset != 0) {
-        LOG_ERR("Invalid write length or offset. Expected 4 bytes at offset 0, got %d bytes at offset %d", len, offset);
-        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    // Parse the UNIX timestamp, the errors are already ATT error codes.
+    uint32_t unix_timestamp;
+    int err = cts_parse_current_time(buf, len, offset, &unix_timestamp);
+    if (err) {
+        LOG_ERR("Invalid write. Expected 4 bytes at offset 0, got %d bytes at offset %d", len, offset);
+        return BT_GATT_ERR(err);
     }
-
-    // Extract the UNIX timestamp from the buffer (assuming little-endian)
-    uint32_t unix_timestamp = sys_le32_to_cpu(*(uint32_t *)buf);
     LOG_DBG("Received UNIX timestamp: %u", unix_timestamp);
 
     // Get the device twin instance to get the UTC zone
@@ -42,15 +72,24 @@ static ssize_t m_time_write_callback(
         return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
     }
     device_twin->unix_time = unix_timestamp;
-    trigger_ui_update();
+    device_twin->last_time_sync = unix_timestamp;
+    if (IS_ENABLED(CONFIG_ZW_USERINTERFACE)) trigger_ui_update();
+    if (IS_ENABLED(CONFIG_ZW_BLE_STATUS_BROADCAST)) bluetooth_status_changed();
 
-    // Convert UNIX timestamp to local time using the device's UTC zone to print.
-    datetime_t local_time = unix_to_localtime(unix_timestamp, device_twin->utc_zone);
-    LOG_INF("Current time updated to local time: %04d-%02d-%02d %02d:%02d:%02d (UTC%+d)", 
-        local_time.year, local_time.month, local_time.day,
-        local_time.hour, local_time.minute, local_time.second,
-        device_twin->utc_zone);
+    // Only integers are logged in the RX thread, the host decodes the dictionary log.
+    BENCHMARK_LOG_CALL(time_write_log_cycles,
+        LOG_INF("Current time updated to UNIX %u (UTC%+d).", unix_timestamp, device_twin->utc_zone));
+
+    // The local time conversion is only worth doing for the debug builds.
+    if (IS_ENABLED(CONFIG_ZW_LOG_LEVEL_DBG)) {
+        datetime_t local_time = unix_to_localtime(unix_timestamp, device_twin->utc_zone);
+        LOG_DBG("Local time: %04d-%02d-%02d %02d:%02d:%02d", local_time.year, local_time.month,
+                local_time.day, local_time.hour, local_time.minute, local_time.second);
+    }
 
+#if defined(CONFIG_ZW_BLE_STATS)
+    benchmark_metric_record(&time_write_handling, k_cyc_to_us_floor32(k_cycle_get_32() - start_cycles));
+#endif
     return len;
 }
 
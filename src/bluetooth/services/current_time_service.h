@@ -16,6 +16,9 @@ extern "C" {
 #include <zephyr/logging/log.h>
 #include <zephyr/bluetooth/gatt.h>
 
+/* Parse a write to the current time characteristic. Returns 0 or an ATT error code. */
+int cts_parse_current_time(const void *buf, uint16_t len, uint16_t offset, uint32_t *unix_time);
+
 /* A function to trigger UI updates - to be implemented in main.c */
 extern void trigger_ui_update();
 
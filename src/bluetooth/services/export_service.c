@@ -0,0 +1,365 @@
+/** Activity Export Service implementation.
+ * A record is encoded relative to the previous one: the time difference (zigzag varint), the
+ * steps (varint), the battery level difference (zigzag varint) and the flags, which is about 5
+ * bytes instead of 8. At most CONFIG_ZW_BLE_EXPORT_WINDOW batches are sent without an
+ * acknowledgement. The acknowledged position is kept per peer identity in RAM and saved to the
+ * settings, and a new START of the same phone continues from there. The RAM copy is read first,
+ * the saved one only after a reboot.
+ *
+ * @license: GNU v3
+ * @maintainer: electricalgorithm @ github
+ */
+
+#include <stdio.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+
+#include "benchmark/benchmark.h"
+#include "bluetooth/services/export_service.h"
+#include "history/history.h"
+
+LOG_MODULE_REGISTER(ZephyrWatch_BLE_Export, CONFIG_ZW_LOG_LEVEL);
+
+#define BT_UUID_EXPORT_VAL BT_UUID_128_ENCODE(0x7a770001, 0x5a57, 0x4e8a, 0x9c1e, 0x3f2b6d0a1c00)
+#define BT_UUID_EXPORT_CONTROL_VAL BT_UUID_128_ENCODE(0x7a770002, 0x5a57, 0x4e8a, 0x9c1e, 0x3f2b6d0a1c00)
+#define BT_UUID_EXPORT_DATA_VAL BT_UUID_128_ENCODE(0x7a770003, 0x5a57, 0x4e8a, 0x9c1e, 0x3f2b6d0a1c00)
+#define BT_UUID_EXPORT BT_UUID_DECLARE_128(BT_UUID_EXPORT_VAL)
+#define BT_UUID_EXPORT_CONTROL BT_UUID_DECLARE_128(BT_UUID_EXPORT_CONTROL_VAL)
+#define BT_UUID_EXPORT_DATA BT_UUID_DECLARE_128(BT_UUID_EXPORT_DATA_VAL)
+
+// Position of the data characteristic value in the service.
+#define EXPORT_DATA_ATTR_INDEX 4
+// Largest notification with the maximum data length: 251 minus the L2CAP and ATT headers.
+#define EXPORT_BATCH_MAX 244
+// Longest encoded record: 5 + 3 + 2 varint bytes and the flags.
+#define EXPORT_RECORD_MAX 11
+#define EXPORT_RETRY_MS 20
+// Other notify errors are retried with a doubling delay, then the export is given up.
+#define EXPORT_ERROR_RETRY_MAX_MS 1000
+#define EXPORT_ERROR_RETRIES 6
+#define EXPORT_CURSOR_KEY "zw/export"
+#define EXPORT_CURSOR_KEY_MAX sizeof(EXPORT_CURSOR_KEY "/ffffffffffff0")
+
+// State of the export. One phone exports at a time.
+static struct bt_conn *export_conn;
+static uint32_t send_seq;
+static uint32_t acked_seq;
+static uint32_t end_seq;
+static bool end_sent;
+static bool completed;
+static uint32_t batch_end[CONFIG_ZW_BLE_EXPORT_WINDOW];
+static uint8_t batch_first;
+static uint8_t batch_inflight;
+static uint8_t batch_buf[EXPORT_BATCH_MAX];
+static uint8_t error_retries;
+static K_MUTEX_DEFINE(export_lock);
+
+// Cursors of the recent peers, the oldest one is replaced.
+typedef struct {
+    bool used;
+    bt_addr_le_t peer;
+    uint32_t seq;
+} export_cursor_t;
+
+static export_cursor_t cursors[CONFIG_BT_MAX_PAIRED];
+static uint8_t cursor_next;
+
+static void export_send_worker(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(export_send_work, export_send_worker);
+
+#if defined(CONFIG_ZW_BLE_STATS)
+// Throughput, and the time the link is up for the export of a day of records.
+static BENCHMARK_METRIC_DEFINE(export_throughput, "Export throughput", "records/s");
+static BENCHMARK_METRIC_DEFINE(export_time_per_day, "Export link time per day of data", "ms");
+static int64_t export_start_ms;
+static uint32_t export_start_seq;
+#endif
+
+/* PUT_VARINT
+ * Write the value in 7-bit groups, the low group first. Returns the number of bytes.
+ */
+static size_t put_varint(uint8_t *buf, uint32_t value) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        buf[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buf[length++] = (uint8_t)value;
+    return length;
+}
+
+static uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+/* EXPORT_ENCODE_BATCH
+ * Encode the records from seq until the buffer, the range or the history ends.
+ */
+size_t export_encode_batch(uint32_t seq, uint32_t end, uint8_t *buf, size_t size, uint8_t *count) {
+    history_record_t record;
+    history_record_t previous = { 0 };
+    size_t length = EXPORT_BATCH_HEADER_LENGTH;
+
+    *count = 0;
+    if (size < EXPORT_BATCH_HEADER_LENGTH) return 0;
+    sys_put_le32(seq, buf);
+    sys_put_le32(0, buf + 4);
+    while (seq != end && *count < UINT8_MAX && size - length >= EXPORT_RECORD_MAX &&
+           history_read(seq, &record) == 0) {
+        if (*count == 0) {
+            sys_put_le32(record.unix_time, buf + 4);
+            previous.unix_time = record.unix_time;
+        }
+        length += put_varint(buf + length, zigzag((int32_t)(record.unix_time - previous.unix_time)));
+        length += put_varint(buf + length, record.steps);
+        length += put_varint(buf + length, zigzag((int32_t)record.battery_level - previous.battery_level));
+        buf[length++] = record.flags;
+        previous = record;
+        (*count)++;
+        seq++;
+    }
+    buf[8] = *count;
+    return length;
+}
+
+/* CURSOR_KEY
+ * Settings key of the cursor of the peer: its identity address and type.
+ */
+static void cursor_key(struct bt_conn *conn, char *key, size_t size) {
+    const bt_addr_le_t *peer = bt_conn_get_dst(conn);
+    snprintf(key, size, EXPORT_CURSOR_KEY "/%02x%02x%02x%02x%02x%02x%u", peer->a.val[5], peer->a.val[4],
+             peer->a.val[3], peer->a.val[2], peer->a.val[1], peer->a.val[0], peer->type);
+}
+
+static int load_cursor(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg, void *param) {
+    if (len != sizeof(uint32_t)) return -EINVAL;
+    return read_cb(cb_arg, param, sizeof(uint32_t)) == sizeof(uint32_t) ? 0 : -EIO;
+}
+
+/* FIND_CURSOR
+ * Return the RAM cursor of the peer, or take a slot for it if create is set. Called with the lock.
+ */
+static export_cursor_t *find_cursor(struct bt_conn *conn, bool create) {
+    const bt_addr_le_t *peer = bt_conn_get_dst(conn);
+    for (int i = 0; i < ARRAY_SIZE(cursors); i++) {
+        if (cursors[i].used && bt_addr_le_eq(&cursors[i].peer, peer)) return &cursors[i];
+    }
+    if (!create) return NULL;
+
+    export_cursor_t *cursor = &cursors[cursor_next];
+    cursor_next = (cursor_next + 1) % ARRAY_SIZE(cursors);
+    cursor->used = true;
+    bt_addr_le_copy(&cursor->peer, peer);
+    cursor->seq = 0;
+    return cursor;
+}
+
+/* LOAD_PEER_CURSOR
+ * Read the cursor of the peer from RAM, or from the settings the first time after a reboot.
+ */
+static uint32_t load_peer_cursor(struct bt_conn *conn) {
+    export_cursor_t *cursor = find_cursor(conn, false);
+    if (cursor == NULL) {
+        char key[EXPORT_CURSOR_KEY_MAX];
+        cursor = find_cursor(conn, true);
+        cursor_key(conn, key, sizeof(key));
+        settings_load_subtree_direct(key, load_cursor, &cursor->seq);
+    }
+    return cursor->seq;
+}
+
+/* EXPORT_START
+ * Start sending from the record, or from the stored cursor of the peer. Called with the lock.
+ */
+static void export_start(struct bt_conn *conn, bool from_cursor, uint32_t seq) {
+    if (from_cursor) {
+        seq = load_peer_cursor(conn);
+    }
+
+    // Records older than the ring are lost. A cursor ahead of the history is from before the
+    // numbering was lost, everything kept is new to the peer.
+    uint32_t first = history_first_seq();
+    uint32_t next = history_next_seq();
+    if (seq - first > next - first) {
+        seq = first;
+    }
+
+    if (export_conn != NULL) bt_conn_unref(export_conn);
+    export_conn = bt_conn_ref(conn);
+    send_seq = acked_seq = seq;
+    end_seq = next;
+    end_sent = false;
+    completed = false;
+    batch_first = batch_inflight = 0;
+    error_retries = 0;
+#if defined(CONFIG_ZW_BLE_STATS)
+    export_start_ms = k_uptime_get();
+    export_start_seq = seq;
+#endif
+    LOG_INF("Export of records %u to %u is started.", seq, next);
+    k_work_reschedule(&export_send_work, K_NO_WAIT);
+}
+
+/* EXPORT_ACK
+ * Release the acknowledged batches from the window and store the new cursor. Called with the lock.
+ */
+static void export_ack(uint32_t seq) {
+    if (seq - acked_seq > send_seq - acked_seq) {
+        LOG_WRN("Acknowledgement of record %u is out of the window.", seq);
+        return;
+    }
+    acked_seq = seq;
+    while (batch_inflight && (int32_t)(batch_end[batch_first] - seq) <= 0) {
+        batch_first = (batch_first + 1) % CONFIG_ZW_BLE_EXPORT_WINDOW;
+        batch_inflight--;
+    }
+
+    char key[EXPORT_CURSOR_KEY_MAX];
+    find_cursor(export_conn, true)->seq = seq;
+    cursor_key(export_conn, key, sizeof(key));
+    settings_save_one(key, &seq, sizeof(seq));
+
+    if (seq == end_seq && !completed) {
+        completed = true;
+#if defined(CONFIG_ZW_BLE_STATS)
+        uint32_t records = seq - export_start_seq;
+        uint32_t elapsed_ms = MAX((uint32_t)(k_uptime_get() - export_start_ms), 1);
+        if (records) {
+            benchmark_metric_record(&export_throughput, records * 1000 / elapsed_ms);
+            benchmark_metric_record(&export_time_per_day,
+                                    (uint32_t)((uint64_t)elapsed_ms * (24 * 60 / CONFIG_ZW_HISTORY_INTERVAL_MIN) / records));
+        }
+#endif
+        LOG_INF("Export is completed at record %u.", seq);
+    }
+    k_work_reschedule(&export_send_work, K_NO_WAIT);
+}
+
+/* Control point write callback */
+static ssize_t write_control(struct bt_conn *conn, const struct bt_gatt_attr *attr, const void *buf,
+                             uint16_t len, uint16_t offset, uint8_t flags) {
+    const uint8_t *data = buf;
+    if (offset != 0) return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    if (len < 1) return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+
+    switch (data[0]) {
+    case EXPORT_CMD_START:
+        if (len != 1 && len != 5) return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+        break;
+    case EXPORT_CMD_ACK:
+        if (len != 5) return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+        break;
+    case EXPORT_CMD_STOP:
+        if (len != 1) return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+        break;
+    default:
+        return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+    }
+    if (conn == NULL) return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+
+    k_mutex_lock(&export_lock, K_FOREVER);
+    ssize_t ret = len;
+    if (data[0] == EXPORT_CMD_START) {
+        // The data characteristic value follows the control point value and its declaration.
+        if (bt_gatt_is_subscribed(conn, attr + 2, BT_GATT_CCC_NOTIFY)) {
+            export_start(conn, len == 1, len == 5 ? sys_get_le32(data + 1) : 0);
+        } else {
+            ret = BT_GATT_ERR(BT_ATT_ERR_CCC_IMPROPER_CONF);
+        }
+    } else if (conn != export_conn) {
+        ret = BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+    } else if (data[0] == EXPORT_CMD_ACK) {
+        export_ack(sys_get_le32(data + 1));
+    } else {
+        LOG_INF("Export is stopped at record %u.", acked_seq);
+        end_sent = completed = true;
+    }
+    k_mutex_unlock(&export_lock);
+    return ret;
+}
+
+static void data_ccc_changed(const struct bt_gatt_attr *attr, uint16_t value) {
+    LOG_DBG("Export notifications %s.", value == BT_GATT_CCC_NOTIFY ? "enabled" : "disabled");
+}
+
+/* Activity Export Service Declaration */
+BT_GATT_SERVICE_DEFINE(export_svc,
+    BT_GATT_PRIMARY_SERVICE(BT_UUID_EXPORT),
+    BT_GATT_CHARACTERISTIC(
+        BT_UUID_EXPORT_CONTROL,
+        BT_GATT_CHRC_WRITE,
+        BT_GATT_PERM_WRITE_ENCRYPT,
+        NULL, write_control, NULL
+    ),
+    BT_GATT_CHARACTERISTIC(
+        BT_UUID_EXPORT_DATA,
+        BT_GATT_CHRC_NOTIFY,
+        BT_GATT_PERM_NONE,
+        NULL, NULL, NULL
+    ),
+    BT_GATT_CCC(data_ccc_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE_ENCRYPT),
+);
+
+/* EXPORT_SEND_WORKER
+ * Fill the window with batches, then the end marker once all the records are sent. When the
+ * host runs out of buffers, it tries again a bit later. Other errors are retried with a backoff,
+ * and the export ends after a few of them; the next START continues from the cursor.
+ */
+static void export_send_worker(struct k_work *work) {
+    k_mutex_lock(&export_lock, K_FOREVER);
+    while (export_conn != NULL && !end_sent && batch_inflight < CONFIG_ZW_BLE_EXPORT_WINDOW) {
+        // Records added during the export are left to the next one. No records is the end.
+        uint8_t count;
+        size_t size = MIN(bt_gatt_get_mtu(export_conn) - 3, sizeof(batch_buf));
+        size_t length = export_encode_batch(send_seq, end_seq, batch_buf, size, &count);
+
+        int err = bt_gatt_notify(export_conn, &export_svc.attrs[EXPORT_DATA_ATTR_INDEX], batch_buf, length);
+        if (err == -ENOMEM) {
+            k_work_reschedule(&export_send_work, K_MSEC(EXPORT_RETRY_MS));
+            break;
+        }
+        if (err) {
+            if (error_retries == EXPORT_ERROR_RETRIES) {
+                LOG_ERR("Export is ended at record %u, sending failed (err %d).", acked_seq, err);
+                end_sent = completed = true;
+                break;
+            }
+            uint32_t delay_ms = MIN(EXPORT_RETRY_MS << ++error_retries, EXPORT_ERROR_RETRY_MAX_MS);
+            LOG_WRN("Sending the export batch failed (err %d), retrying in %u ms.", err, delay_ms);
+            k_work_reschedule(&export_send_work, K_MSEC(delay_ms));
+            break;
+        }
+        error_retries = 0;
+
+        if (count == 0) {
+            // Records dropped from the ring meanwhile can not be sent, the range ends here.
+            end_sent = true;
+            end_seq = send_seq;
+            break;
+        }
+        send_seq += count;
+        batch_end[(batch_first + batch_inflight) % CONFIG_ZW_BLE_EXPORT_WINDOW] = send_seq;
+        batch_inflight++;
+    }
+    k_mutex_unlock(&export_lock);
+}
+
+static void process_disconnection(struct bt_conn *conn, uint8_t reason) {
+    k_mutex_lock(&export_lock, K_FOREVER);
+    if (conn == export_conn) {
+        // The cursor is at the last acknowledgement, the next START continues from there.
+        LOG_INF("Export is interrupted at record %u.", acked_seq);
+        bt_conn_unref(export_conn);
+        export_conn = NULL;
+    }
+    k_mutex_unlock(&export_lock);
+}
+
+BT_CONN_CB_DEFINE(export_connection_callbacks) = {
+    .disconnected = process_disconnection,
+};
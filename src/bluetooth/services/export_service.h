@@ -0,0 +1,41 @@
+/** Activity Export Service interface.
+ * GATT service the phone pulls the activity history with. The phone writes the commands to the
+ * control point and receives the records as notifications of the data characteristic, in
+ * batches sized to the MTU. Every acknowledgement moves the cursor of the phone, which is kept
+ * in the settings, so an export broken by a lost link continues where it stopped.
+ *
+ * @license: GNU v3
+ * @maintainer: electricalgorithm @ github
+ */
+
+#ifndef EXPORT_SERVICE_H
+#define EXPORT_SERVICE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "history/history.h"
+
+/* Commands written to the control point. */
+#define EXPORT_CMD_START 0x01 // [seq LE32]: from the stored cursor, or from the given record.
+#define EXPORT_CMD_ACK 0x02   // seq LE32: all the records before seq are received.
+#define EXPORT_CMD_STOP 0x03
+
+/* Batch header: sequence number of the first record (LE32), its UNIX time (LE32), count. A
+ * batch with no records ends the export.
+ */
+#define EXPORT_BATCH_HEADER_LENGTH 9
+
+/* Encode the records from seq until end into the buffer, as many as fit. Returns the length of
+ * the batch and sets the number of records in it.
+ */
+size_t export_encode_batch(uint32_t seq, uint32_t end, uint8_t *buf, size_t size, uint8_t *count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EXPORT_SERVICE_H
@@ -0,0 +1,270 @@
+/** Calendar Subsystem for ZephyrWatch.
+ * The events are found with a binary search on their start time. Only one reminder is armed at a
+ * time: a reminder is at most 255 minutes before its event, so the search for the next one stops
+ * at the events starting more than that after the best reminder found. The events are saved as one
+ * settings entry, a second after the last change, so a sync of many events is one write.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/atomic.h>
+
+#include "calendar/calendar.h"
+#include "datetime/datetime.h"
+
+LOG_MODULE_REGISTER(ZephyrWatch_Calendar, CONFIG_ZW_LOG_LEVEL);
+
+#define CALENDAR_KEY "zw/cal"
+#define CALENDAR_REMINDER_MAX_S (UINT8_MAX * 60)
+#define CALENDAR_SAVE_DELAY_MS 1000
+#define CALENDAR_REMINDERS_PENDING 4
+
+// The saved events go through the overflow heap of the storage subsystem, not the flash write
+// in the caller, when the heap has room for all of them.
+#if defined(CONFIG_ZW_STORAGE)
+BUILD_ASSERT(CONFIG_ZW_STORAGE_OVERFLOW_SIZE >= CONFIG_ZW_CALENDAR_EVENTS * sizeof(calendar_event_t) + 256,
+             "ZW_STORAGE_OVERFLOW_SIZE is too small for the calendar.");
+#endif
+
+static calendar_event_t events[CONFIG_ZW_CALENDAR_EVENTS];
+static size_t event_count;
+static atomic_t revision;
+static K_MUTEX_DEFINE(calendar_lock);
+
+// The armed reminder, the time of the last one that went off, and the events of the reminders
+// which went off but are not shown yet.
+static uint32_t reminder_time;
+static uint32_t reminded_until;
+K_MSGQ_DEFINE(reminder_msgq, sizeof(calendar_event_t), CALENDAR_REMINDERS_PENDING, 4);
+
+static void reminder_worker(struct k_work *work);
+static K_WORK_DEFINE(reminder_work, reminder_worker);
+static void calendar_save_worker(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(calendar_save_work, calendar_save_worker);
+
+/* LOWER_BOUND
+ * Index of the first event starting at or after the time.
+ */
+static size_t lower_bound(uint32_t unix_time) {
+    size_t low = 0;
+    size_t high = event_count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (events[middle].start < unix_time) low = middle + 1;
+        else high = middle;
+    }
+    return low;
+}
+
+/* FIND_ID
+ * Index of the event with the identifier, or -1.
+ */
+static int find_id(uint16_t id) {
+    for (size_t i = 0; i < event_count; i++) {
+        if (events[i].id == id) return i;
+    }
+    return -1;
+}
+
+/* INSERT_EVENT
+ * Put the event at its place in the array. Called with the lock, there must be room.
+ */
+static void insert_event(const calendar_event_t *event) {
+    size_t index = lower_bound(event->start);
+    memmove(&events[index + 1], &events[index], (event_count - index) * sizeof(events[0]));
+    events[index] = *event;
+    events[index].title[CALENDAR_TITLE_MAX - 1] = '\0';
+    event_count++;
+}
+
+/* REMOVE_INDEX
+ * Close the gap of the removed event. Called with the lock.
+ */
+static void remove_index(size_t index) {
+    memmove(&events[index], &events[index + 1], (event_count - index - 1) * sizeof(events[0]));
+    event_count--;
+}
+
+/* ARM_NEXT_REMINDER
+ * Find the earliest reminder after the last one, of an event which has not started yet, and arm
+ * it. Called with the lock.
+ */
+static void arm_next_reminder() {
+    uint32_t now = get_current_unix_time();
+    uint32_t best = UINT32_MAX;
+    for (size_t i = lower_bound(MAX(now, reminded_until) + 1); i < event_count; i++) {
+        if (events[i].start > (uint64_t)best + CALENDAR_REMINDER_MAX_S) break;
+        if (events[i].reminder_min == 0) continue;
+        uint32_t at = events[i].start - events[i].reminder_min * 60;
+        if (at > reminded_until && at < best) best = at;
+    }
+
+    reminder_time = best;
+    if (best == UINT32_MAX) {
+        datetime_disarm_deadline(&reminder_work);
+        return;
+    }
+    datetime_arm_deadline(best, &reminder_work);
+    LOG_DBG("Next reminder is at %u.", best);
+}
+
+/* CHANGED
+ * Note a modification, arm the reminder again and save the events after the sync. Called with
+ * the lock.
+ */
+static void changed() {
+    atomic_inc(&revision);
+    arm_next_reminder();
+    if (IS_ENABLED(CONFIG_SETTINGS)) {
+        k_work_reschedule(&calendar_save_work, K_MSEC(CALENDAR_SAVE_DELAY_MS));
+    }
+}
+
+/* CALENDAR_SAVE_WORKER
+ * Save all the events as one entry, from a copy so the lock is not held during the save.
+ */
+static void calendar_save_worker(struct k_work *work) {
+    static calendar_event_t saved[CONFIG_ZW_CALENDAR_EVENTS];
+    k_mutex_lock(&calendar_lock, K_FOREVER);
+    size_t count = event_count;
+    memcpy(saved, events, count * sizeof(events[0]));
+    k_mutex_unlock(&calendar_lock);
+
+    int ret = settings_save_one(CALENDAR_KEY, saved, count * sizeof(saved[0]));
+    if (ret) {
+        LOG_WRN("Calendar events couldn't be saved. (RET: %d)", ret);
+    }
+}
+
+/* REMINDER_WORKER
+ * The deadline is reached: keep the events of the reminder for the user interface. Several events
+ * can have their reminder at the same time.
+ */
+static void reminder_worker(struct k_work *work) {
+    k_mutex_lock(&calendar_lock, K_FOREVER);
+    uint32_t now = get_current_unix_time();
+    for (size_t i = lower_bound(now + 1); i < event_count; i++) {
+        if (events[i].start > (uint64_t)reminder_time + CALENDAR_REMINDER_MAX_S) break;
+        if (events[i].reminder_min && events[i].start - events[i].reminder_min * 60 == reminder_time) {
+            LOG_INF("Reminder: %s in %u min.", events[i].title, events[i].reminder_min);
+            if (k_msgq_put(&reminder_msgq, &events[i], K_NO_WAIT)) {
+                LOG_WRN("Reminder of %s is dropped, too many are pending.", events[i].title);
+            }
+        }
+    }
+    reminded_until = reminder_time;
+    arm_next_reminder();
+    k_mutex_unlock(&calendar_lock);
+}
+
+static int load_events(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg, void *param) {
+    if (len % sizeof(calendar_event_t) || len > sizeof(events)) return -EINVAL;
+    if (read_cb(cb_arg, events, len) != len) return -EIO;
+    event_count = len / sizeof(calendar_event_t);
+    return 0;
+}
+
+/* ENABLE_CALENDAR_SUBSYSTEM
+ * Load the events saved under the calendar key.
+ */
+int enable_calendar_subsystem() {
+    k_mutex_lock(&calendar_lock, K_FOREVER);
+    if (IS_ENABLED(CONFIG_SETTINGS)) {
+        int ret = settings_subsys_init();
+        if (ret == 0) ret = settings_load_subtree_direct(CALENDAR_KEY, load_events, NULL);
+        if (ret) {
+            LOG_WRN("Calendar events couldn't be loaded. (RET: %d)", ret);
+        }
+    }
+    // The reminders before the current time are not repeated.
+    reminded_until = get_current_unix_time();
+    changed();
+    LOG_DBG("Calendar has %u events.", event_count);
+    k_mutex_unlock(&calendar_lock);
+    return 0;
+}
+
+/* CALENDAR_PUT
+ * Replace the event with the same identifier, or add it.
+ */
+int calendar_put(const calendar_event_t *event) {
+    k_mutex_lock(&calendar_lock, K_FOREVER);
+    int index = find_id(event->id);
+    if (index >= 0) {
+        remove_index(index);
+    } else if (event_count >= CONFIG_ZW_CALENDAR_EVENTS) {
+        k_mutex_unlock(&calendar_lock);
+        return -ENOMEM;
+    }
+    insert_event(event);
+    changed();
+    k_mutex_unlock(&calendar_lock);
+    return 0;
+}
+
+/* CALENDAR_REMOVE
+ * Remove the event with the identifier.
+ */
+int calendar_remove(uint16_t id) {
+    k_mutex_lock(&calendar_lock, K_FOREVER);
+    int index = find_id(id);
+    if (index < 0) {
+        k_mutex_unlock(&calendar_lock);
+        return -ENOENT;
+    }
+    remove_index(index);
+    changed();
+    k_mutex_unlock(&calendar_lock);
+    return 0;
+}
+
+/* CALENDAR_CLEAR
+ * Remove all the events.
+ */
+void calendar_clear() {
+    k_mutex_lock(&calendar_lock, K_FOREVER);
+    event_count = 0;
+    changed();
+    k_mutex_unlock(&calendar_lock);
+}
+
+size_t calendar_count() {
+    return event_count;
+}
+
+/* CALENDAR_FIND
+ * Binary search of the time among the start times.
+ */
+size_t calendar_find(uint32_t unix_time) {
+    k_mutex_lock(&calendar_lock, K_FOREVER);
+    size_t index = lower_bound(unix_time);
+    k_mutex_unlock(&calendar_lock);
+    return index;
+}
+
+int calendar_get(size_t index, calendar_event_t *event) {
+    int ret = -ENOENT;
+    k_mutex_lock(&calendar_lock, K_FOREVER);
+    if (index < event_count) {
+        *event = events[index];
+        ret = 0;
+    }
+    k_mutex_unlock(&calendar_lock);
+    return ret;
+}
+
+uint32_t calendar_revision() {
+    return (uint32_t)atomic_get(&revision);
+}
+
+int calendar_take_reminder(calendar_event_t *event) {
+    return k_msgq_get(&reminder_msgq, event, K_NO_WAIT) == 0 ? 0 : -ENOENT;
+}
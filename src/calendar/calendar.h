@@ -0,0 +1,64 @@
+/** Calendar Subsystem for ZephyrWatch.
+ * Keeps the events synced from the phone in an array sorted by their start time, and saves them
+ * as one settings entry once a sync is over. The reminder of the next event is armed as the
+ * deadline of the datetime subsystem.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#ifndef _CALENDAR_H
+#define _CALENDAR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Longest title, with the terminating zero. */
+#define CALENDAR_TITLE_MAX 24
+
+/* An event in 32 bytes. The identifier is given by the phone. */
+typedef struct {
+    uint32_t start;          // UNIX time
+    uint16_t duration_min;
+    uint16_t id;
+    uint8_t reminder_min;    // Minutes before the start, 0 for no reminder.
+    uint8_t reserved;
+    char title[CALENDAR_TITLE_MAX];
+} calendar_event_t;
+
+/* Load the stored events and arm the first reminder. */
+int enable_calendar_subsystem();
+
+/* Add the event, or replace the one with the same identifier. Returns 0, or -ENOMEM if full. */
+int calendar_put(const calendar_event_t *event);
+
+/* Remove the event with the identifier. Returns 0, or -ENOENT. */
+int calendar_remove(uint16_t id);
+
+/* Remove all the events. */
+void calendar_clear();
+
+/* Number of the events. */
+size_t calendar_count();
+
+/* Index of the first event starting at or after the time, calendar_count() if none. */
+size_t calendar_find(uint32_t unix_time);
+
+/* Copy the event at the index. Returns 0, or -ENOENT. */
+int calendar_get(size_t index, calendar_event_t *event);
+
+/* Changes with every modification of the events. */
+uint32_t calendar_revision();
+
+/* Copy the event of the oldest reminder that went off and was not taken yet. Returns 0, or -ENOENT. */
+int calendar_take_reminder(calendar_event_t *event);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
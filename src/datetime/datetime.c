@@ -9,9 +9,11 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/device.h>
 #include <zephyr/drivers/counter.h>
+#include <zephyr/spinlock.h>
 
 #include "devicetwin/devicetwin.h"
 #include "datetime/datetime.h"
+#include "simulation/simulation.h"
 
 // Get devices from the device tree.
 #define RTC_COUNTER_DEVICE DT_ALIAS(rtccounterdevice)
@@ -21,7 +23,28 @@
 #define ALARM_CHANNEL_ID 0
 
 /* Register a logger for this library. */
-LOG_MODULE_REGISTER(ZephyrWatch_Datetime, LOG_LEVEL_INF);
+LOG_MODULE_REGISTER(ZephyrWatch_Datetime, CONFIG_ZW_LOG_LEVEL);
+
+/* Prototype definition of internal static functions and variables */
+static const uint16_t days_in_month[] = {
+    31, 28, 31, 30, 31, 30,
+    31, 31, 30, 31, 30, 31
+};
+static bool is_leap_year(uint16_t year);
+static uint8_t calc_weekday(uint32_t days_since_epoch);
+static uint32_t sunday_of_month(uint16_t year, uint8_t month, int8_t nth);
+static void dst_period(uint16_t year, int32_t standard_offset, datetime_dst_rule_t rule,
+                       uint32_t *start, uint32_t *end);
+
+/* The single deadline. The time is compared with it on every update, so nothing is scanned or
+ * polled while waiting for it.
+ */
+static uint32_t deadline_time = UINT32_MAX;
+static struct k_work *deadline_work;
+static struct k_spinlock deadline_lock;
+
+/* The real-time counter part is only built with CONFIG_ZW_DATETIME, the conversions are always. */
+#if defined(CONFIG_ZW_DATETIME)
 
 /* Disable flag to not set alarm again in ISR.
  * 0: Set alarm again.
@@ -32,14 +55,11 @@ static uint8_t reset_alarm = 0;
 /* Global alarm configuration structure - must persist for ISR access */
 static struct counter_alarm_cfg alarm_cfg;
 
-/* Prototype definition of internal static functions and variables */
-static const uint16_t days_in_month[] = {
-    31, 28, 31, 30, 31, 30,
-    31, 31, 30, 31, 30, 31
-};
-static bool is_leap_year(uint16_t year);
-static uint8_t calc_weekday(uint32_t days_since_epoch);
+/* Alarm interval in counter ticks. It is calculated once, out of the ISR.
+ */
+static uint32_t alarm_interval_ticks;
 
+#if defined(CONFIG_ZW_DATETIME_DRIFT_CORRECTION)
 /* Since our board's RTC is not an real-time clock but a real-time counter,
  * we do get a drift in the time as 4 minutes per hour. It means 0.06 seconds drift per each second,
  * and we need to resolve it as much as we can. Within this drift code, we aim to add extra 1 second
@@ -51,6 +71,7 @@ static uint8_t calc_weekday(uint32_t days_since_epoch);
 #define DRIFT_DETECTION_SECONDS 15
 #define DRIFT_CORRECTION_SECONDS 1
 static uint32_t last_drift = 0;
+#endif
 
 /* RTC_ISR
  * Interrupt service routine for alarm with real-time counters.  This ISR is executed every
@@ -60,9 +81,13 @@ void rtc_isr(const struct device *dev, uint8_t channel_id, uint32_t ticks, void
     // Cast alarm config from user data.
     struct counter_alarm_cfg *alarm_cfg = user_data;
 
+    if (IS_ENABLED(CONFIG_ZW_SIMULATION)) {
+        simulation_note_wakeup(SIMULATION_WAKEUP_RTC_ISR);
+    }
+
     // Reset alarm if flag is set.
     if (!reset_alarm) {
-        alarm_cfg->ticks = counter_us_to_ticks(dev, ALARM_INTERVAL_US);
+        alarm_cfg->ticks = alarm_interval_ticks;
         counter_set_channel_alarm(dev, ALARM_CHANNEL_ID, alarm_cfg);
     }
 
@@ -70,11 +95,13 @@ void rtc_isr(const struct device *dev, uint8_t channel_id, uint32_t ticks, void
     uint32_t current_unix_time = get_current_unix_time();
     uint8_t update_amount = 1;  // Always +1 since ISR called every second.
 
+#if defined(CONFIG_ZW_DATETIME_DRIFT_CORRECTION)
     // Apply a manual drift correction to the time.
     if (current_unix_time - last_drift >= DRIFT_DETECTION_SECONDS) {
         update_amount += DRIFT_CORRECTION_SECONDS;
         last_drift = current_unix_time + update_amount;
     }
+#endif
 
     // Update the system time.
     set_current_unix_time(current_unix_time + update_amount);
@@ -104,8 +131,9 @@ int enable_datetime_subsystem() {
     LOG_DBG("Real time counter started successfully.");
 
     // Configure the global alarm structure.
+    alarm_interval_ticks = counter_us_to_ticks(real_time_counter, ALARM_INTERVAL_US);
     alarm_cfg.flags = 0;
-    alarm_cfg.ticks = counter_us_to_ticks(real_time_counter, ALARM_INTERVAL_US);
+    alarm_cfg.ticks = alarm_interval_ticks;
     alarm_cfg.callback = rtc_isr;
     alarm_cfg.user_data = &alarm_cfg;
 
@@ -147,6 +175,7 @@ int disable_datetime_subsystem() {
 
     return 0;
 }
+#endif /* CONFIG_ZW_DATETIME */
 
 /* GET_CURRENT_UNIX_TIME
  * Return the UNIX epochs of the current time.
@@ -163,9 +192,43 @@ int set_current_unix_time(uint32_t new_time) {
     // Update the system time.
     device_twin_t *device_twin = get_device_twin_instance();
     device_twin->unix_time = new_time;
+
+    // Only the comparison runs every second, the work is submitted once per deadline.
+    if (new_time >= deadline_time) {
+        k_spinlock_key_t key = k_spin_lock(&deadline_lock);
+        struct k_work *work = deadline_work;
+        deadline_time = UINT32_MAX;
+        deadline_work = NULL;
+        k_spin_unlock(&deadline_lock, key);
+        if (work != NULL) k_work_submit(work);
+    }
     return 0;
 }
 
+/* DATETIME_ARM_DEADLINE
+ * Replace the deadline. A deadline in the past is submitted at once.
+ */
+void datetime_arm_deadline(uint32_t deadline, struct k_work *work) {
+    bool reached = deadline <= get_current_unix_time();
+    k_spinlock_key_t key = k_spin_lock(&deadline_lock);
+    deadline_work = reached ? NULL : work;
+    deadline_time = reached ? UINT32_MAX : deadline;
+    k_spin_unlock(&deadline_lock, key);
+    if (reached) k_work_submit(work);
+}
+
+/* DATETIME_DISARM_DEADLINE
+ * Clear the deadline if it still belongs to the work.
+ */
+void datetime_disarm_deadline(struct k_work *work) {
+    k_spinlock_key_t key = k_spin_lock(&deadline_lock);
+    if (deadline_work == work) {
+        deadline_time = UINT32_MAX;
+        deadline_work = NULL;
+    }
+    k_spin_unlock(&deadline_lock, key);
+}
+
 /* GET_CURRENT_LOCAL_TIME
  * Return the current time in datetime_t object in local time zone.
  */
@@ -231,6 +294,71 @@ datetime_t unix_to_utc(uint32_t timestamp) {
     return unix_to_localtime((int32_t)timestamp, 0);
 }
 
+/* DATETIME_TO_UNIX
+ * Converts a local time with its UTC offset in hours back to Unix time. The weekday is ignored.
+ * Returns 0 for the dates before 1970 and the invalid dates.
+ */
+uint32_t datetime_to_unix(const datetime_t *local_time, int8_t utc_offset_hours) {
+    if (local_time->year < 1970 || local_time->month < 1 || local_time->month > 12 ||
+        local_time->day < 1 || local_time->hour > 23 || local_time->minute > 59 ||
+        local_time->second > 59) {
+        return 0;
+    }
+
+    uint16_t dim = days_in_month[local_time->month - 1];
+    if (local_time->month == 2 && is_leap_year(local_time->year)) dim++;
+    if (local_time->day > dim) {
+        return 0;
+    }
+
+    // Date part
+    uint32_t days = 0;
+    for (uint16_t year = 1970; year < local_time->year; year++) {
+        days += is_leap_year(year) ? 366 : 365;
+    }
+    for (uint8_t month = 0; month < local_time->month - 1; month++) {
+        days += days_in_month[month];
+        if (month == 1 && is_leap_year(local_time->year)) days++;
+    }
+    days += local_time->day - 1;
+
+    // Time part and the time zone offset
+    int64_t timestamp = (int64_t)days * 86400 + local_time->hour * 3600 + local_time->minute * 60 +
+                        local_time->second - utc_offset_hours * 3600;
+    if (timestamp < 0 || timestamp > UINT32_MAX) {
+        return 0;
+    }
+    return (uint32_t)timestamp;
+}
+
+/* DATETIME_ZONE_OFFSET
+ * Returns the offset of the zone in seconds, and when it changes next. The transitions are only
+ * computed here, so a caller keeping next_change can reuse the offset until then.
+ */
+int32_t datetime_zone_offset(uint32_t timestamp, int16_t standard_offset_minutes,
+                             datetime_dst_rule_t rule, uint32_t *next_change) {
+    int32_t standard_offset = standard_offset_minutes * 60;
+    if (rule == DATETIME_DST_NONE) {
+        *next_change = UINT32_MAX;
+        return standard_offset;
+    }
+
+    uint32_t start, end;
+    uint16_t year = unix_to_utc(timestamp).year;
+    dst_period(year, standard_offset, rule, &start, &end);
+    if (timestamp < start) {
+        *next_change = start;
+        return standard_offset;
+    }
+    if (timestamp < end) {
+        *next_change = end;
+        return standard_offset + 3600;
+    }
+    dst_period(year + 1, standard_offset, rule, &start, &end);
+    *next_change = start;
+    return standard_offset;
+}
+
 /** **************** **/
 /** STATIC FUNCTIONS **/
 /** **************** **/
@@ -248,3 +376,36 @@ static bool is_leap_year(uint16_t year) {
 static uint8_t calc_weekday(uint32_t days_since_epoch) {
     return (days_since_epoch + 4) % 7; // 1970-01-01 = Thursday
 }
+
+/* SUNDAY_OF_MONTH
+ * Unix time of the midnight (UTC) of the nth Sunday of the month, the last one if nth is -1.
+ */
+static uint32_t sunday_of_month(uint16_t year, uint8_t month, int8_t nth) {
+    datetime_t first = { .year = year, .month = month, .day = 1 };
+    uint32_t days = datetime_to_unix(&first, 0) / 86400;
+
+    uint8_t dim = days_in_month[month - 1];
+    if (month == 2 && is_leap_year(year)) dim++;
+    uint8_t day;
+    if (nth < 0) {
+        day = dim - calc_weekday(days + dim - 1);
+    } else {
+        day = 1 + (7 - calc_weekday(days)) % 7 + (nth - 1) * 7;
+    }
+    return (days + day - 1) * 86400;
+}
+
+/* DST_PERIOD
+ * The daylight saving start and end of the year in Unix time.
+ */
+static void dst_period(uint16_t year, int32_t standard_offset, datetime_dst_rule_t rule,
+                       uint32_t *start, uint32_t *end) {
+    if (rule == DATETIME_DST_EU) {
+        *start = sunday_of_month(year, 3, -1) + 3600;
+        *end = sunday_of_month(year, 10, -1) + 3600;
+    } else {
+        // 02:00 standard time in March, 02:00 daylight time in November.
+        *start = sunday_of_month(year, 3, 2) + 2 * 3600 - standard_offset;
+        *end = sunday_of_month(year, 11, 1) + 2 * 3600 - (standard_offset + 3600);
+    }
+}
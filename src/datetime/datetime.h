@@ -9,6 +9,7 @@
 #define _DATETIME_H
 
 #include <stdint.h>
+#include <zephyr/kernel.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -25,6 +26,13 @@ typedef struct {
     uint8_t  weekday; // 0 = Sunday, ..., 6 = Saturday
 } datetime_t;
 
+/* Daylight saving rules of the time zones. */
+typedef enum {
+    DATETIME_DST_NONE,
+    DATETIME_DST_EU, // Last Sunday of March to the last Sunday of October, 01:00 UTC.
+    DATETIME_DST_US, // Second Sunday of March to the first Sunday of November, 02:00 local.
+} datetime_dst_rule_t;
+
 /* Enables the subsystem to track the real time. */
 int enable_datetime_subsystem();
 
@@ -37,6 +45,14 @@ uint32_t get_current_unix_time();
 /* Set the current time in UNIX epochs. */
 int set_current_unix_time(uint32_t new_time);
 
+/* Submit the work once the current time reaches the deadline (UNIX epochs), or at once if it
+ * already has. There is a single deadline, arming a new one replaces it.
+ */
+void datetime_arm_deadline(uint32_t deadline, struct k_work *work);
+
+/* Cancel the deadline, if the work is the one armed. */
+void datetime_disarm_deadline(struct k_work *work);
+
 /* Get the current time in datetime_t struct in local time zone. */
 datetime_t get_current_local_time(int8_t utc_offset_hours);
 
@@ -46,6 +62,15 @@ datetime_t unix_to_localtime(int32_t timestamp, int8_t utc_offset_hours);
 /* Converts Unix time to UTC using datetime_t. */
 datetime_t unix_to_utc(uint32_t timestamp);
 
+/* Converts local time in datetime_t back to Unix time, 0 if the date is invalid. */
+uint32_t datetime_to_unix(const datetime_t *local_time, int8_t utc_offset_hours);
+
+/* Offset of a time zone from UTC in seconds at the given time. The next instant the offset
+ * changes is written to next_change, UINT32_MAX if it never does.
+ */
+int32_t datetime_zone_offset(uint32_t timestamp, int16_t standard_offset_minutes,
+                             datetime_dst_rule_t rule, uint32_t *next_change);
+
 #ifdef __cplusplus
 }
 #endif
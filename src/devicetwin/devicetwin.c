@@ -4,7 +4,6 @@
  * @maintainer: electricalgorithm @ github 
  */
 
-#include <stdlib.h>
 #include "devicetwin/devicetwin.h"
 
 // Function to construct a single device twin instance. This is a singleton.
@@ -14,10 +13,17 @@ device_twin_t* get_device_twin_instance(void) {
     return s_device_twin_instance;
 }
 
+// The twin is read by the RTC ISR, so it is a static in the internal DRAM rather than on the
+// heap, which may be backed by PSRAM.
+static device_twin_t s_device_twin_storage;
+
 device_twin_t* create_device_twin_instance(uint32_t unix_time, int8_t utc_zone) {
-    device_twin_t* instance = malloc(sizeof(device_twin_t));
+    device_twin_t* instance = &s_device_twin_storage;
     instance->unix_time = unix_time;
     instance->utc_zone = utc_zone;
+    instance->battery_level = DEVICE_TWIN_BATTERY_UNKNOWN;
+    instance->step_count = 0;
+    instance->last_time_sync = 0;
     // For now, we'll assume the singleton instance is always created.
     s_device_twin_instance = instance;
     return instance;
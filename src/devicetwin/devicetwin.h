@@ -22,8 +22,16 @@ extern "C" {
 typedef struct {
     uint32_t unix_time;
     int8_t utc_zone;
+    // Battery charge in percent, DEVICE_TWIN_BATTERY_UNKNOWN until it is measured.
+    uint8_t battery_level;
+    // Steps counted today.
+    uint32_t step_count;
+    // UNIX time of the last time set by the phone, 0 if it was never set.
+    uint32_t last_time_sync;
 } device_twin_t;
 
+#define DEVICE_TWIN_BATTERY_UNKNOWN 0xFF
+
 /*
  * Function to construct a new device twin instance with given parameters.
  */
@@ -1,22 +1,44 @@
 /** Display Subsystem for ZephyrWatch.
- * Provides functions to initialize the display system.
+ * Provides functions to initialize the display system. The power modes are the MIPI DCS commands
+ * of the GC9A01, sent to its MIPI DBI bus next to the display driver.
  *
  * @license GNU v3
  * @maintainer electricalgorithm @ github
  */
 
 #include "display/display.h"
+#include "power/power.h"
+#include "touch/touch.h"
+#include <errno.h>
 #include <zephyr/drivers/display.h>
+#include <zephyr/drivers/mipi_dbi.h>
 #include <zephyr/drivers/pwm.h>
 #include <zephyr/logging/log.h>
 
 // Get a logger for the display subsystem.
-LOG_MODULE_REGISTER(ZephyrWatch_Display, LOG_LEVEL_INF);
+LOG_MODULE_REGISTER(ZephyrWatch_Display, CONFIG_ZW_LOG_LEVEL);
 
 // Get devices from the device tree.
 #define DISPLAY_DEVICE DT_ALIAS(lcddisplaydevice)
 #define DISPLAY_PWM_DEVICE DT_ALIAS(lcdpwmdevice)
 
+// The panel modes need the MIPI DBI bus of a GC9A01.
+#if DT_NODE_HAS_COMPAT(DISPLAY_DEVICE, galaxycore_gc9x01x) && defined(CONFIG_MIPI_DBI)
+#define DISPLAY_HAS_MODES 1
+static const struct mipi_dbi_config display_dbi_config =
+    MIPI_DBI_CONFIG_DT(DISPLAY_DEVICE, SPI_OP_MODE_MASTER | SPI_WORD_SET(8), 0);
+#endif
+
+// MIPI DCS commands of the panel modes.
+#define DISPLAY_CMD_IDLE_OFF 0x38
+#define DISPLAY_CMD_IDLE_ON 0x39
+
+static display_mode_t display_mode = DISPLAY_MODE_FULL;
+
+// Backlight PWM period and pulse.
+#define BACKLIGHT_PERIOD 500
+#define BACKLIGHT_PULSE 250
+
 /* ENABLE_DISPLAY_SUBSYSTEM
  * Set the Zephyr display device and set backlight.
  */
@@ -31,6 +53,8 @@ int enable_display_subsystem() {
     }
     LOG_DBG("Display device is ready.");
 
+    // Boards without a backlight PWM (e.g. native_sim) only have the display.
+#if defined(CONFIG_PWM) && DT_NODE_EXISTS(DISPLAY_PWM_DEVICE)
     const struct pwm_dt_spec backlight = PWM_DT_SPEC_GET_BY_IDX(DISPLAY_PWM_DEVICE, 0);
     ret = pwm_is_ready_dt(&backlight);
     if (!ret) {
@@ -39,12 +63,13 @@ int enable_display_subsystem() {
     }
     LOG_DBG("PWM device is ready.");
 
-    ret = pwm_set_dt(&backlight, 500, 250);
+    ret = pwm_set_dt(&backlight, BACKLIGHT_PERIOD, BACKLIGHT_PULSE);
     if (ret) {
         LOG_ERR("Failed to set PWM pulse, exiting... (RET: %d)", ret);
         return ret;
     }
     LOG_DBG("PWM pulse for LCD backlight set.");
+#endif
 
     ret = display_blanking_off(display_dev);
     if (ret) {
@@ -53,6 +78,16 @@ int enable_display_subsystem() {
     }
     LOG_DBG("Set the blanking off.");
 
+    // The power model assumes the backlight of the watch even when the board has none.
+    if (IS_ENABLED(CONFIG_ZW_POWER)) {
+        power_state_set(POWER_DOMAIN_PANEL, POWER_STATE_ON);
+        power_backlight_set_duty(BACKLIGHT_PULSE * 100 / BACKLIGHT_PERIOD);
+        power_state_set(POWER_DOMAIN_BACKLIGHT, POWER_STATE_ON);
+    }
+
+    if (IS_ENABLED(CONFIG_ZW_TOUCH)) {
+        touch_set_standby(false);
+    }
     return 0;
 }
 
@@ -61,7 +96,34 @@ int enable_display_subsystem() {
  * Disable the Zephyr display device and set backlight to 0.
  */
 int disable_display_subsystem() {
-    LOG_DBG("Not implemented yet.");
+    int ret;
+
+    const struct device *display_dev = DEVICE_DT_GET(DISPLAY_DEVICE);
+    ret = display_blanking_on(display_dev);
+    if (ret) {
+        LOG_ERR("Failed to set blanking on. (RET: %d)", ret);
+        return ret;
+    }
+
+#if defined(CONFIG_PWM) && DT_NODE_EXISTS(DISPLAY_PWM_DEVICE)
+    const struct pwm_dt_spec backlight = PWM_DT_SPEC_GET_BY_IDX(DISPLAY_PWM_DEVICE, 0);
+    ret = pwm_set_dt(&backlight, BACKLIGHT_PERIOD, 0);
+    if (ret) {
+        LOG_ERR("Failed to set PWM pulse to zero. (RET: %d)", ret);
+        return ret;
+    }
+#endif
+
+    if (IS_ENABLED(CONFIG_ZW_POWER)) {
+        power_state_set(POWER_DOMAIN_BACKLIGHT, POWER_STATE_OFF);
+        power_state_set(POWER_DOMAIN_PANEL, POWER_STATE_OFF);
+    }
+
+    // The display is turned on again by a touch, the controller keeps scanning slowly for it.
+    if (IS_ENABLED(CONFIG_ZW_TOUCH)) {
+        touch_set_standby(true);
+    }
+    LOG_DBG("Display is turned off.");
     return 0;
 }
 
@@ -71,4 +133,51 @@ int disable_display_subsystem() {
 int change_brightness(uint8_t perc) {
     LOG_DBG("Not implemented yet.");
     return 0;
-}
\ No newline at end of file
+}
+
+#if defined(DISPLAY_HAS_MODES)
+/* DISPLAY_COMMAND
+ * Send a command to the panel over the MIPI DBI bus of the display.
+ */
+static int display_command(uint8_t command, const uint8_t *data, size_t length) {
+    const struct device *dbi_dev = DEVICE_DT_GET(DT_PARENT(DISPLAY_DEVICE));
+    return mipi_dbi_command_write(dbi_dev, &display_dbi_config, command, data, length);
+}
+#endif
+
+/* DISPLAY_SET_MODE
+ * Leave the current mode of the panel and enter the new one. The power model follows the panel.
+ */
+int display_set_mode(display_mode_t mode) {
+#if defined(DISPLAY_HAS_MODES)
+    if (mode == display_mode) {
+        return 0;
+    }
+
+    int ret = display_command(mode == DISPLAY_MODE_IDLE ? DISPLAY_CMD_IDLE_ON : DISPLAY_CMD_IDLE_OFF, NULL, 0);
+    if (ret) {
+        LOG_ERR("Failed to switch the panel to mode %d. (RET: %d)", mode, ret);
+        return ret;
+    }
+
+    display_mode = mode;
+    if (IS_ENABLED(CONFIG_ZW_POWER)) {
+        static const uint8_t panel_states[] = {
+            [DISPLAY_MODE_FULL] = POWER_STATE_ON,
+            [DISPLAY_MODE_IDLE] = POWER_STATE_PANEL_IDLE,
+        };
+        power_state_set(POWER_DOMAIN_PANEL, panel_states[mode]);
+    }
+    LOG_DBG("Panel is in mode %d.", mode);
+    return 0;
+#else
+    return -ENOTSUP;
+#endif
+}
+
+/* DISPLAY_GET_MODE
+ * Get the current panel mode.
+ */
+display_mode_t display_get_mode() {
+    return display_mode;
+}
@@ -1,5 +1,5 @@
 /** Display Subsystem for ZephyrWatch.
- * Provides functions to initialize the display system.
+ * Provides functions to initialize the display system, and the power modes of the GC9A01 panel.
  *
  * @license GNU v3
  * @maintainer electricalgorithm @ github
@@ -14,10 +14,24 @@
 extern "C" {
 #endif
 
+/* Power modes of the panel. In the idle mode the panel shows 8 colors, the most significant bit
+ * of each channel.
+ */
+typedef enum {
+    DISPLAY_MODE_FULL,
+    DISPLAY_MODE_IDLE,
+} display_mode_t;
+
 int enable_display_subsystem();
 int disable_display_subsystem();
 int change_brightness(uint8_t perc);
 
+/* Switch the panel into a power mode. Returns -ENOTSUP if the display has no such modes. */
+int display_set_mode(display_mode_t mode);
+
+/* The power mode the panel is in. */
+display_mode_t display_get_mode();
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
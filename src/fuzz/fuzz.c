@@ -0,0 +1,116 @@
+/** Fuzzing harness for ZephyrWatch.
+ * Built on native_sim with libFuzzer (CONFIG_ARCH_POSIX_LIBFUZZER). For every input, the fuzz
+ * interrupt wakes up the harness thread, which hands the input to one of the targets: the write
+ * callbacks of all the GATT services of the watch, or the binary parsers called directly. The
+ * first byte of the input selects the target, so the fuzzer learns to reach all of them.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/irq.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/bluetooth/gatt.h>
+
+#include "bluetooth/clients/cts_client.h"
+#include "bluetooth/services/current_time_service.h"
+#include "datetime/datetime.h"
+
+LOG_MODULE_REGISTER(ZephyrWatch_Fuzz, CONFIG_ZW_LOG_LEVEL);
+
+#define FUZZ_STACK_SIZE 4096
+#define FUZZ_PRIORITY 5
+
+// Input of the current run, provided by the native_sim libFuzzer integration.
+extern const uint8_t *posix_fuzz_buf;
+extern size_t posix_fuzz_sz;
+
+static K_SEM_DEFINE(fuzz_run_sem, 0, 1);
+
+/* FUZZ_GATT_WRITES
+ * Call the write callback of every characteristic value with the input. Two bytes of the input
+ * choose the attribute and two the offset, the rest is the written value. The CCC descriptors
+ * belong to the host and need a connection, they are skipped.
+ */
+static void fuzz_gatt_writes(const uint8_t *data, size_t size) {
+    if (size < 4 || size - 4 > UINT16_MAX) return;
+    uint16_t index = sys_get_le16(data);
+    uint16_t offset = sys_get_le16(data + 2);
+
+    uint16_t attr_count = 0;
+    STRUCT_SECTION_FOREACH(bt_gatt_service_static, service) {
+        attr_count += service->attr_count;
+    }
+    if (attr_count == 0) return;
+    index %= attr_count;
+
+    STRUCT_SECTION_FOREACH(bt_gatt_service_static, service) {
+        if (index >= service->attr_count) {
+            index -= service->attr_count;
+            continue;
+        }
+        const struct bt_gatt_attr *attr = &service->attrs[index];
+        if (attr->write != NULL && attr->write != bt_gatt_attr_write_ccc) {
+            attr->write(NULL, attr, data + 4, (uint16_t)(size - 4), offset, 0);
+        }
+        return;
+    }
+}
+
+/* FUZZ_CTS_PARSER
+ * Parse the input as a current time write.
+ */
+static void fuzz_cts_parser(const uint8_t *data, size_t size) {
+    uint32_t unix_time;
+    if (size < 2 || size - 2 > UINT16_MAX) return;
+    cts_parse_current_time(data + 2, (uint16_t)(size - 2), sys_get_le16(data), &unix_time);
+}
+
+#if defined(CONFIG_ZW_BLE_CTS_CLIENT)
+/* FUZZ_CTS_CLIENT_PARSER
+ * Parse the input as the current time of the phone and convert it like the client does.
+ */
+static void fuzz_cts_client_parser(const uint8_t *data, size_t size) {
+    datetime_t local_time;
+    if (size > UINT16_MAX) return;
+    if (cts_client_parse_current_time(data, (uint16_t)size, &local_time) == 0) {
+        datetime_to_unix(&local_time, 0);
+    }
+}
+#endif
+
+// Targets selected by the first byte of the input. New parsers are added to the end.
+static void (*const fuzz_targets[])(const uint8_t *data, size_t size) = {
+    fuzz_gatt_writes,
+    fuzz_cts_parser,
+#if defined(CONFIG_ZW_BLE_CTS_CLIENT)
+    fuzz_cts_client_parser,
+#endif
+};
+
+/* FUZZ_ISR
+ * The fuzz interrupt is raised for every input, the input is handled in the thread to go
+ * through the same context as the BT RX thread would.
+ */
+static void fuzz_isr(const void *arg) {
+    k_sem_give(&fuzz_run_sem);
+}
+
+/* FUZZ_THREAD
+ * Hand each input to its target.
+ */
+static void fuzz_thread(void *p1, void *p2, void *p3) {
+    IRQ_CONNECT(CONFIG_ARCH_POSIX_FUZZ_IRQ, 0, fuzz_isr, NULL, 0);
+    irq_enable(CONFIG_ARCH_POSIX_FUZZ_IRQ);
+    LOG_INF("Fuzzing %zu targets.", ARRAY_SIZE(fuzz_targets));
+
+    while (1) {
+        k_sem_take(&fuzz_run_sem, K_FOREVER);
+        if (posix_fuzz_sz == 0) continue;
+        fuzz_targets[posix_fuzz_buf[0] % ARRAY_SIZE(fuzz_targets)](posix_fuzz_buf + 1, posix_fuzz_sz - 1);
+    }
+}
+
+K_THREAD_DEFINE(fuzz_thread_id, FUZZ_STACK_SIZE, fuzz_thread, NULL, NULL, NULL, FUZZ_PRIORITY, 0, 0);
@@ -0,0 +1,150 @@
+/** Activity History Subsystem for ZephyrWatch.
+ * The records are kept in RAM, the sequence number in the settings. After a reboot the records
+ * are gone but the numbering continues, so the cursors of the readers stay valid and point to
+ * records which are not kept any more.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#include <errno.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/spinlock.h>
+
+#include "devicetwin/devicetwin.h"
+#include "history/history.h"
+#include "sleep/sleep.h"
+
+LOG_MODULE_REGISTER(ZephyrWatch_History, CONFIG_ZW_LOG_LEVEL);
+
+#define HISTORY_SEQ_KEY "zw/hist/seq"
+
+static history_record_t records[CONFIG_ZW_HISTORY_RECORDS];
+static uint32_t first_seq;
+static uint32_t next_seq;
+static uint32_t last_step_count;
+static struct k_spinlock history_lock;
+
+static void history_sample_worker(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(history_sample_work, history_sample_worker);
+
+/* LOAD_SEQ
+ * Settings callback of the stored sequence number.
+ */
+static int load_seq(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg, void *param) {
+    if (len != sizeof(uint32_t)) return -EINVAL;
+    return read_cb(cb_arg, param, sizeof(uint32_t)) == sizeof(uint32_t) ? 0 : -EIO;
+}
+
+#if defined(CONFIG_ZW_HISTORY_PREFILL)
+/* HISTORY_PREFILL
+ * Fill the ring with records up to now. The steps and the battery vary, so the records encode
+ * to different lengths like the real ones.
+ */
+static void history_prefill() {
+    uint32_t now = get_device_twin_instance()->unix_time;
+    for (uint32_t i = 0; i < CONFIG_ZW_HISTORY_RECORDS; i++) {
+        records[next_seq % CONFIG_ZW_HISTORY_RECORDS] = (history_record_t){
+            .unix_time = now - (CONFIG_ZW_HISTORY_RECORDS - i) * CONFIG_ZW_HISTORY_INTERVAL_MIN * 60,
+            .steps = (i * 7919) % 1500,
+            .battery_level = 100 - i * 100 / CONFIG_ZW_HISTORY_RECORDS,
+            .flags = HISTORY_FLAG_TIME_SYNCED,
+        };
+        next_seq++;
+    }
+}
+#endif
+
+/* ENABLE_HISTORY_SUBSYSTEM
+ * Continue the numbering from the last boot, and take the first sample after an interval.
+ */
+int enable_history_subsystem() {
+    if (IS_ENABLED(CONFIG_SETTINGS)) {
+        uint32_t stored_seq = 0;
+        int ret = settings_subsys_init();
+        if (ret == 0) ret = settings_load_subtree_direct(HISTORY_SEQ_KEY, load_seq, &stored_seq);
+        if (ret) {
+            LOG_WRN("History sequence couldn't be loaded. (RET: %d)", ret);
+        }
+        first_seq = next_seq = stored_seq;
+    }
+
+#if defined(CONFIG_ZW_HISTORY_PREFILL)
+    history_prefill();
+#endif
+    last_step_count = get_device_twin_instance()->step_count;
+    k_work_schedule(&history_sample_work, K_MINUTES(CONFIG_ZW_HISTORY_INTERVAL_MIN));
+    LOG_DBG("History starts at record %u.", next_seq);
+    return 0;
+}
+
+/* HISTORY_FIRST_SEQ
+ * Sequence number of the oldest record in the ring.
+ */
+uint32_t history_first_seq() {
+    k_spinlock_key_t key = k_spin_lock(&history_lock);
+    uint32_t seq = first_seq;
+    k_spin_unlock(&history_lock, key);
+    return seq;
+}
+
+/* HISTORY_NEXT_SEQ
+ * Sequence number of the next sample.
+ */
+uint32_t history_next_seq() {
+    k_spinlock_key_t key = k_spin_lock(&history_lock);
+    uint32_t seq = next_seq;
+    k_spin_unlock(&history_lock, key);
+    return seq;
+}
+
+/* HISTORY_READ
+ * The record of a sequence number is in the slot of the number modulo the ring size.
+ */
+int history_read(uint32_t seq, history_record_t *record) {
+    int ret = -ENOENT;
+    k_spinlock_key_t key = k_spin_lock(&history_lock);
+    if (seq - first_seq < next_seq - first_seq) {
+        *record = records[seq % CONFIG_ZW_HISTORY_RECORDS];
+        ret = 0;
+    }
+    k_spin_unlock(&history_lock, key);
+    return ret;
+}
+
+/* HISTORY_SAMPLE_WORKER
+ * Append a record. The step count restarts every day, a smaller count means a new day.
+ */
+static void history_sample_worker(struct k_work *work) {
+    device_twin_t *device_twin = get_device_twin_instance();
+    uint32_t steps = device_twin->step_count >= last_step_count ? device_twin->step_count - last_step_count
+                                                                : device_twin->step_count;
+    last_step_count = device_twin->step_count;
+
+    history_record_t record = {
+        .unix_time = device_twin->unix_time,
+        .steps = MIN(steps, UINT16_MAX),
+        .battery_level = device_twin->battery_level,
+        .flags = device_twin->last_time_sync ? HISTORY_FLAG_TIME_SYNCED : 0,
+    };
+    if (IS_ENABLED(CONFIG_ZW_SLEEP)) {
+        record.flags |= MIN(sleep_take_epochs(), HISTORY_FLAG_SLEEP_EPOCHS_MASK);
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&history_lock);
+    records[next_seq % CONFIG_ZW_HISTORY_RECORDS] = record;
+    next_seq++;
+    if (next_seq - first_seq > CONFIG_ZW_HISTORY_RECORDS) {
+        first_seq = next_seq - CONFIG_ZW_HISTORY_RECORDS;
+    }
+    uint32_t stored_seq = next_seq;
+    k_spin_unlock(&history_lock, key);
+
+    if (IS_ENABLED(CONFIG_SETTINGS)) {
+        settings_save_one(HISTORY_SEQ_KEY, &stored_seq, sizeof(stored_seq));
+    }
+    k_work_schedule(&history_sample_work, K_MINUTES(CONFIG_ZW_HISTORY_INTERVAL_MIN));
+}
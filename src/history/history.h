@@ -0,0 +1,49 @@
+/** Activity History Subsystem for ZephyrWatch.
+ * Samples the steps and the battery level of the device twin at a fixed interval into a ring of
+ * 8-byte records. Every record has a sequence number, which keeps counting over reboots, so a
+ * reader can continue from the last record it has seen.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#ifndef _HISTORY_H
+#define _HISTORY_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A sample of the activity. The steps are the ones taken since the previous record, the flags
+ * also hold the number of 30-second epochs scored as sleep since then.
+ */
+typedef struct {
+    uint32_t unix_time;
+    uint16_t steps;
+    uint8_t battery_level;
+    uint8_t flags;
+} history_record_t;
+
+/* Flags of a record. */
+#define HISTORY_FLAG_TIME_SYNCED 0x80
+#define HISTORY_FLAG_SLEEP_EPOCHS_MASK 0x7F
+
+/* Restore the sequence number and start the sampling. */
+int enable_history_subsystem();
+
+/* Sequence number of the oldest record still kept. */
+uint32_t history_first_seq();
+
+/* Sequence number the next record will get. */
+uint32_t history_next_seq();
+
+/* Copy the record with the sequence number. Returns 0, or -ENOENT if it is not kept. */
+int history_read(uint32_t seq, history_record_t *record);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
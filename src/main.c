@@ -10,19 +10,32 @@
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 
+#include "benchmark/benchmark.h"
 #include "watchdog/watchdog.h"
 #include "display/display.h"
+#include "touch/touch.h"
 #include "devicetwin/devicetwin.h"
 #include "userinterface/userinterface.h"
 #include "datetime/datetime.h"
 #include "bluetooth/infrastructure.h"
+#include "simulation/simulation.h"
+#include "power/power.h"
+#include "storage/storage.h"
+#include "history/history.h"
+#include "calendar/calendar.h"
+#include "sleep/sleep.h"
 
 // Define the logger.
-LOG_MODULE_REGISTER(ZephyrWatch, LOG_LEVEL_INF);
+LOG_MODULE_REGISTER(ZephyrWatch, CONFIG_ZW_LOG_LEVEL);
 
 #define SLEEP_UI_STABILIZE_MS 2000
 #define SLEEP_MAIN_CORE_MS 20
 
+#if defined(CONFIG_ZW_STORAGE_STATS)
+// Length of the main loop iterations overlapped by a flash write, beyond the sleep.
+static BENCHMARK_METRIC_DEFINE(ui_flash_stall, "UI loop stall by flash write", "ms");
+#endif
+
 // Setting for device's time zone.
 int8_t utc_zone = +2;
 
@@ -30,12 +43,26 @@ int main(void) {
     int ret;
 
     // Set-up watchdog before all the subsystems.
-    ret = enable_watchdog_subsystem();
-    if (ret) {
-        LOG_ERR("Watchdog subsystem couldn't be enabled. (RET: %d)", ret);
-        return ret;
+    if (IS_ENABLED(CONFIG_ZW_WATCHDOG)) {
+        ret = enable_watchdog_subsystem();
+        if (ret) {
+            LOG_ERR("Watchdog subsystem couldn't be enabled. (RET: %d)", ret);
+            return ret;
+        }
+        LOG_INF("Watchdog system is enabled.");
+    }
+
+    // Start reporting the performance metrics.
+    if (IS_ENABLED(CONFIG_ZW_BENCHMARK)) {
+        enable_benchmark_subsystem();
+        LOG_INF("Benchmark subsystem is enabled.");
+    }
+
+    // Estimate the current consumption from the subsystem states.
+    if (IS_ENABLED(CONFIG_ZW_POWER)) {
+        enable_power_subsystem();
+        LOG_INF("Power model is enabled.");
     }
-    LOG_INF("Watchdog system is enabled.");
 
     // Create the device twin.
     device_twin_t* device_twin = create_device_twin_instance(0, utc_zone);
@@ -45,45 +72,118 @@ int main(void) {
     }
     LOG_INF("Device twin instance created successfully.");
 
+    // Start the time-warp simulation before the UI shows the time.
+    if (IS_ENABLED(CONFIG_ZW_SIMULATION)) {
+        enable_simulation_subsystem();
+        LOG_INF("Simulation subsystem is enabled.");
+    }
+
     // Init the display subsystem.
-    ret = enable_display_subsystem();
-    if (ret) {
-        LOG_ERR("Display subsystem couldn't enabled. (RET: %d)", ret);
-        return ret;
+    if (IS_ENABLED(CONFIG_ZW_DISPLAY)) {
+        ret = enable_display_subsystem();
+        if (ret) {
+            LOG_ERR("Display subsystem couldn't enabled. (RET: %d)", ret);
+            return ret;
+        }
+        LOG_INF("Display subsystem is enabled.");
     }
-    LOG_INF("Display subsystem is enabled.");
 
-    // Initialize the display device with initial user interface.
-    user_interface_init();
-    LOG_INF("User interface subsystem is enabled.");
+    if (IS_ENABLED(CONFIG_ZW_USERINTERFACE)) {
+        // Initialize the display device with initial user interface.
+        user_interface_init();
+        LOG_INF("User interface subsystem is enabled.");
 
-    // Refresh the UI.
-    user_interface_task_handler();
-    LOG_INF("User interface is refreshed initally.");
+        // Refresh the UI.
+        user_interface_task_handler();
+        LOG_INF("User interface is refreshed initally.");
+    }
+
+    // Let the touch controller recognize the gestures.
+    if (IS_ENABLED(CONFIG_ZW_TOUCH)) {
+        ret = enable_touch_subsystem();
+        if (ret) {
+            LOG_ERR("Touch subsystem couldn't enabled. (RET: %d)", ret);
+        } else {
+            LOG_INF("Touch subsystem is enabled.");
+        }
+    }
 
     // Enable datetime subsystem.
-    ret = enable_datetime_subsystem();
-    if (ret) {
-        LOG_ERR("Datetime subsystem couldn't enabled. (RET: %d)", ret);
-        return ret;
+    if (IS_ENABLED(CONFIG_ZW_DATETIME)) {
+        ret = enable_datetime_subsystem();
+        if (ret) {
+            LOG_ERR("Datetime subsystem couldn't enabled. (RET: %d)", ret);
+            return ret;
+        }
+        LOG_INF("Datetime subsystem is enabled.");
     }
-    LOG_INF("Datetime subsystem is enabled.");
-
-    // Initialize the Bluetooth stack.
-    // Give the system more time to stabilize before initializing Bluetooth.
-    k_sleep(K_MSEC(SLEEP_UI_STABILIZE_MS));
-    ret = enable_bluetooth_subsystem();
-    if (ret) {
-        LOG_ERR("Bluetooth subsystem couldn't enabled. (RET: %d)", ret);
-        return ret;
+
+    // Defer the settings writes before the Bluetooth stack starts saving.
+    if (IS_ENABLED(CONFIG_ZW_STORAGE)) {
+        ret = enable_storage_subsystem();
+        if (ret) {
+            LOG_ERR("Storage subsystem couldn't enabled. (RET: %d)", ret);
+            return ret;
+        }
+        LOG_INF("Storage subsystem is enabled.");
+    }
+
+    // Record the activity, the numbering continues from the settings.
+    if (IS_ENABLED(CONFIG_ZW_HISTORY)) {
+        enable_history_subsystem();
+        LOG_INF("History subsystem is enabled.");
+    }
+
+    // Load the calendar events and arm the first reminder.
+    if (IS_ENABLED(CONFIG_ZW_CALENDAR)) {
+        enable_calendar_subsystem();
+        LOG_INF("Calendar subsystem is enabled.");
+    }
+
+    // Score the sleep from the accelerometer into the history.
+    if (IS_ENABLED(CONFIG_ZW_SLEEP)) {
+        ret = enable_sleep_subsystem();
+        if (ret) {
+            LOG_ERR("Sleep subsystem couldn't enabled. (RET: %d)", ret);
+        } else {
+            LOG_INF("Sleep subsystem is enabled.");
+        }
+    }
+
+    // Initialize the Bluetooth stack. The fuzzer calls the GATT callbacks without a stack.
+    if (IS_ENABLED(CONFIG_ZW_BLUETOOTH) && !IS_ENABLED(CONFIG_ZW_FUZZ)) {
+        // Give the system more time to stabilize before initializing Bluetooth.
+        k_sleep(K_MSEC(SLEEP_UI_STABILIZE_MS));
+        ret = enable_bluetooth_subsystem();
+        if (ret) {
+            LOG_ERR("Bluetooth subsystem couldn't enabled. (RET: %d)", ret);
+            return ret;
+        }
+        LOG_INF("Bluetooth subsystem is enabled.");
     }
-    LOG_INF("Bluetooth subsystem is enabled.");
 
     while (1) {
-        user_interface_task_handler();
+#if defined(CONFIG_ZW_STORAGE_STATS)
+        uint32_t flash_activity = storage_flash_activity();
+        int64_t loop_start_ms = k_uptime_get();
+#endif
+        if (IS_ENABLED(CONFIG_ZW_SIMULATION)) {
+            simulation_note_wakeup(SIMULATION_WAKEUP_MAIN_LOOP);
+        }
+        if (IS_ENABLED(CONFIG_ZW_USERINTERFACE)) {
+            user_interface_task_handler();
+        }
         k_sleep(K_MSEC(SLEEP_MAIN_CORE_MS));
+#if defined(CONFIG_ZW_STORAGE_STATS)
+        if (storage_flash_activity() != flash_activity) {
+            int64_t loop_ms = k_uptime_get() - loop_start_ms;
+            benchmark_metric_record(&ui_flash_stall, (uint32_t)MAX(loop_ms - SLEEP_MAIN_CORE_MS, 0));
+        }
+#endif
 
         // Kick the watchdog.
-        kick_watchdog();
+        if (IS_ENABLED(CONFIG_ZW_WATCHDOG)) {
+            kick_watchdog();
+        }
     }
-}
\ No newline at end of file
+}
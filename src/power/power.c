@@ -0,0 +1,187 @@
+/** Power Model Subsystem for ZephyrWatch.
+ * Every domain keeps its current state and the time it entered it. On a state change, the time
+ * spent in the previous state is added to its residency and to the charge of the domain (state
+ * current times time, in uA*ms). The CPU is not reported by anyone: the active and idle cycles are
+ * taken from the thread runtime statistics when the model is evaluated.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/spinlock.h>
+
+#include "power/power.h"
+
+LOG_MODULE_REGISTER(ZephyrWatch_Power, CONFIG_ZW_LOG_LEVEL);
+
+#define POWER_MAX_STATES 3
+
+typedef struct {
+    const char *name;
+    uint8_t state_count;
+    const char *state_names[POWER_MAX_STATES];
+    uint32_t state_current_ua[POWER_MAX_STATES];
+} power_domain_info_t;
+
+// Current coefficients of the states. The backlight's on current is at full duty.
+static const power_domain_info_t domain_info[POWER_DOMAIN_COUNT] = {
+    [POWER_DOMAIN_BACKLIGHT] = { "backlight", 2, { "off", "on" },
+                                 { 0, CONFIG_ZW_POWER_BACKLIGHT_FULL_UA } },
+    [POWER_DOMAIN_PANEL] = { "panel", 3, { "off", "on", "idle" },
+                             { CONFIG_ZW_POWER_PANEL_OFF_UA, CONFIG_ZW_POWER_PANEL_ON_UA,
+                               CONFIG_ZW_POWER_PANEL_IDLE_UA } },
+    [POWER_DOMAIN_RADIO] = { "radio", 3, { "off", "advertising", "connected" },
+                             { 0, CONFIG_ZW_POWER_RADIO_ADVERTISING_UA, CONFIG_ZW_POWER_RADIO_CONNECTED_UA } },
+    [POWER_DOMAIN_IMU] = { "IMU", 3, { "off", "low power", "active" },
+                           { 0, CONFIG_ZW_POWER_IMU_LOW_POWER_UA, CONFIG_ZW_POWER_IMU_ACTIVE_UA } },
+};
+
+typedef struct {
+    uint8_t state;
+    int64_t since_ms;
+    uint64_t residency_ms[POWER_MAX_STATES];
+    uint64_t charge_ua_ms;
+} power_domain_state_t;
+
+static power_domain_state_t domains[POWER_DOMAIN_COUNT];
+static uint8_t backlight_duty = 100;
+static struct k_spinlock power_lock;
+
+// Periodic reporter of the estimation.
+static void power_report_worker(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(power_report_work, power_report_worker);
+
+/* STATE_CURRENT_UA
+ * Current of the domain in the given state.
+ */
+static uint32_t state_current_ua(power_domain_t domain, uint8_t state) {
+    uint32_t current = domain_info[domain].state_current_ua[state];
+    if (domain == POWER_DOMAIN_BACKLIGHT) {
+        current = current * backlight_duty / 100;
+    }
+    return current;
+}
+
+/* ACCOUNT_DOMAIN
+ * Add the time since the last change to the current state. Called with the lock held.
+ */
+static void account_domain(power_domain_t domain, int64_t now_ms) {
+    power_domain_state_t *entry = &domains[domain];
+    uint64_t elapsed_ms = now_ms - entry->since_ms;
+    entry->residency_ms[entry->state] += elapsed_ms;
+    entry->charge_ua_ms += elapsed_ms * state_current_ua(domain, entry->state);
+    entry->since_ms = now_ms;
+}
+
+/* CPU_CURRENT_UA
+ * Average CPU current from the active and idle cycles since boot.
+ */
+static uint32_t cpu_current_ua(uint32_t *active_permille) {
+    k_thread_runtime_stats_t stats;
+    if (k_thread_runtime_stats_all_get(&stats) != 0 || stats.execution_cycles == 0) {
+        *active_permille = 1000;
+        return CONFIG_ZW_POWER_CPU_ACTIVE_UA;
+    }
+
+    // The execution cycles include the idle thread, the total cycles do not.
+    *active_permille = (uint32_t)(stats.total_cycles * 1000 / stats.execution_cycles);
+    return (CONFIG_ZW_POWER_CPU_ACTIVE_UA * *active_permille +
+            CONFIG_ZW_POWER_CPU_IDLE_UA * (1000 - *active_permille)) / 1000;
+}
+
+/* ENABLE_POWER_SUBSYSTEM
+ * Start the periodic report. The residencies are counted from boot.
+ */
+int enable_power_subsystem() {
+    k_work_schedule(&power_report_work, K_SECONDS(CONFIG_ZW_POWER_REPORT_INTERVAL_S));
+    LOG_DBG("Power model reporter is scheduled.");
+    return 0;
+}
+
+/* POWER_STATE_SET
+ * Account the previous state and switch to the new one.
+ */
+void power_state_set(power_domain_t domain, uint8_t state) {
+    if (domain >= POWER_DOMAIN_COUNT || state >= domain_info[domain].state_count) {
+        LOG_ERR("Invalid power state %u for domain %d.", state, domain);
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&power_lock);
+    account_domain(domain, k_uptime_get());
+    domains[domain].state = state;
+    k_spin_unlock(&power_lock, key);
+}
+
+/* POWER_BACKLIGHT_SET_DUTY
+ * Account the backlight with the old duty and switch to the new one.
+ */
+void power_backlight_set_duty(uint8_t percent) {
+    k_spinlock_key_t key = k_spin_lock(&power_lock);
+    account_domain(POWER_DOMAIN_BACKLIGHT, k_uptime_get());
+    backlight_duty = MIN(percent, 100);
+    k_spin_unlock(&power_lock, key);
+}
+
+/* POWER_AVERAGE_CURRENT_UA
+ * Sum of the average currents of the domains and the CPU since boot.
+ */
+uint32_t power_average_current_ua() {
+    uint64_t charge_ua_ms = 0;
+    uint32_t active_permille;
+    int64_t now_ms = k_uptime_get();
+
+    k_spinlock_key_t key = k_spin_lock(&power_lock);
+    for (int domain = 0; domain < POWER_DOMAIN_COUNT; domain++) {
+        account_domain(domain, now_ms);
+        charge_ua_ms += domains[domain].charge_ua_ms;
+    }
+    k_spin_unlock(&power_lock, key);
+
+    uint32_t current_ua = cpu_current_ua(&active_permille);
+    if (now_ms > 0) {
+        current_ua += (uint32_t)(charge_ua_ms / now_ms);
+    }
+    return current_ua;
+}
+
+/* POWER_REPORT
+ * Print the residency of each state, the average current of each domain and the projection.
+ */
+void power_report() {
+    int64_t now_ms = k_uptime_get();
+    if (now_ms <= 0) return;
+    uint32_t active_permille;
+    uint32_t total_ua = cpu_current_ua(&active_permille);
+    LOG_INF("Power CPU: active %u.%u %%, %u uA.", active_permille / 10, active_permille % 10, total_ua);
+
+    for (int domain = 0; domain < POWER_DOMAIN_COUNT; domain++) {
+        k_spinlock_key_t key = k_spin_lock(&power_lock);
+        account_domain(domain, now_ms);
+        power_domain_state_t entry = domains[domain];
+        k_spin_unlock(&power_lock, key);
+
+        uint32_t domain_ua = (uint32_t)(entry.charge_ua_ms / now_ms);
+        total_ua += domain_ua;
+        LOG_INF("Power %s: %u uA.", domain_info[domain].name, domain_ua);
+        for (int state = 0; state < domain_info[domain].state_count; state++) {
+            uint32_t permille = (uint32_t)(entry.residency_ms[state] * 1000 / now_ms);
+            if (permille == 0) continue;
+            LOG_INF("  %s: %u.%u %%", domain_info[domain].state_names[state], permille / 10, permille % 10);
+        }
+    }
+
+    uint32_t battery_hours = total_ua ? (uint32_t)((uint64_t)CONFIG_ZW_POWER_BATTERY_MAH * 1000 / total_ua) : 0;
+    LOG_INF("Power total: %u uA, %u h (%u days) with %u mAh.", total_ua, battery_hours,
+            battery_hours / 24, CONFIG_ZW_POWER_BATTERY_MAH);
+}
+
+/* POWER_REPORT_WORKER
+ * Print the estimation and reschedule.
+ */
+static void power_report_worker(struct k_work *work) {
+    power_report();
+    k_work_schedule(&power_report_work, K_SECONDS(CONFIG_ZW_POWER_REPORT_INTERVAL_S));
+}
@@ -0,0 +1,57 @@
+/** Power Model Subsystem for ZephyrWatch.
+ * Estimates the current consumption without measuring it. The subsystems report the state of
+ * their power domain (backlight, panel, radio, IMU), the CPU residency comes from the scheduler,
+ * and each state is multiplied by its current coefficient from Kconfig. The average current and
+ * the projected battery life are printed periodically and at the end of a simulation.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#ifndef _POWER_H
+#define _POWER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Power domains reported by the subsystems. */
+typedef enum {
+    POWER_DOMAIN_BACKLIGHT,
+    POWER_DOMAIN_PANEL,
+    POWER_DOMAIN_RADIO,
+    POWER_DOMAIN_IMU,
+    POWER_DOMAIN_COUNT,
+} power_domain_t;
+
+/* States of the domains. All the domains start in POWER_STATE_OFF. */
+#define POWER_STATE_OFF 0
+#define POWER_STATE_ON 1
+#define POWER_STATE_PANEL_IDLE 2
+#define POWER_STATE_RADIO_ADVERTISING 1
+#define POWER_STATE_RADIO_CONNECTED 2
+#define POWER_STATE_IMU_LOW_POWER 1
+#define POWER_STATE_IMU_ACTIVE 2
+
+/* Start reporting the estimation periodically. */
+int enable_power_subsystem();
+
+/* Change the state of a domain. */
+void power_state_set(power_domain_t domain, uint8_t state);
+
+/* Set the PWM duty of the backlight in percent, the current of the on state scales with it. */
+void power_backlight_set_duty(uint8_t percent);
+
+/* Average current since boot in microamperes. */
+uint32_t power_average_current_ua();
+
+/* Print the residencies, the average current and the battery life to the log. */
+void power_report();
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
@@ -0,0 +1,219 @@
+/** Simulation Subsystem for ZephyrWatch.
+ * Checks the watch against the simulated kernel time once a minute. On native_sim, the kernel
+ * time and the emulated counter both follow the simulated hardware time, which can run much
+ * faster than the wall clock (--rt-ratio=1000 or --no-rt). Since the scheduling of native_sim is
+ * deterministic, two runs of the same build give the same numbers. With the sleep tracking, the
+ * simulation also wears the watch: the emulated accelerometer is still during the night and moves
+ * during the day, and the sleep epochs found in the history are reported.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#include <stdlib.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/logging/log_ctrl.h>
+#include <zephyr/sys/atomic.h>
+#include <posix_board_if.h>
+#if defined(CONFIG_ZW_SLEEP)
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/emul_sensor.h>
+#endif
+
+#include "benchmark/benchmark.h"
+#include "datetime/datetime.h"
+#include "devicetwin/devicetwin.h"
+#include "history/history.h"
+#include "power/power.h"
+#include "simulation/simulation.h"
+#include "userinterface/mempools.h"
+
+LOG_MODULE_REGISTER(ZephyrWatch_Simulation, CONFIG_ZW_LOG_LEVEL);
+
+#define SIMULATION_CHECK_INTERVAL_S 60
+// The clock worker runs every 10 seconds, so the new date has to be shown within a minute.
+#define SIMULATION_ROLLOVER_GRACE_S 60
+#define SIMULATION_DATE(_year, _month, _day) (((uint32_t)(_year) << 9) | ((_month) << 5) | (_day))
+
+static const char *const wakeup_names[SIMULATION_WAKEUP_COUNT] = {
+    "RTC ISR", "clock worker", "date worker", "main loop",
+};
+static atomic_t wakeups[SIMULATION_WAKEUP_COUNT];
+
+// Reference point of the simulated time.
+static int64_t start_uptime_ms;
+
+// Results of the checks.
+static int32_t clock_error_s;
+static int32_t max_clock_error_s;
+static uint32_t rollovers;
+static uint32_t missed_rollovers;
+
+// Date of the device clock and the date on the screen.
+static uint32_t device_date;
+static bool device_date_missed;
+static atomic_t shown_date;
+
+#if defined(CONFIG_ZW_SLEEP)
+// The wrist rests from 23:00 to 07:00. During the day it carries 1.2 g, well above the noise.
+#define SIMULATION_NIGHT_START_H 23
+#define SIMULATION_NIGHT_END_H 7
+#define SIMULATION_DAY_SWING_MG 663
+#endif
+
+static void simulation_check_worker(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(simulation_check_work, simulation_check_worker);
+
+/* ENABLE_SIMULATION_SUBSYSTEM
+ * Set the device clock to the simulation start time and schedule the checks.
+ */
+int enable_simulation_subsystem() {
+    set_current_unix_time(CONFIG_ZW_SIMULATION_START_UNIX_TIME);
+    start_uptime_ms = k_uptime_get();
+
+    device_twin_t *device_twin = get_device_twin_instance();
+    datetime_t local_time = unix_to_localtime(device_twin->unix_time, device_twin->utc_zone);
+    device_date = SIMULATION_DATE(local_time.year, local_time.month, local_time.day);
+#if defined(CONFIG_ZW_SLEEP)
+    simulation_move_wrist(local_time.hour);
+#endif
+
+    k_work_schedule(&simulation_check_work, K_SECONDS(SIMULATION_CHECK_INTERVAL_S));
+    LOG_INF("Simulation of %d hours started at UNIX %u.",
+            CONFIG_ZW_SIMULATION_DURATION_HOURS, CONFIG_ZW_SIMULATION_START_UNIX_TIME);
+    return 0;
+}
+
+/* SIMULATION_NOTE_WAKEUP
+ * Count a wakeup. It is only an atomic increment, so ISRs can call it.
+ */
+void simulation_note_wakeup(simulation_wakeup_t source) {
+    atomic_inc(&wakeups[source]);
+}
+
+/* SIMULATION_NOTE_DATE_SHOWN
+ * Remember the date the home screen shows.
+ */
+void simulation_note_date_shown(uint16_t year, uint8_t month, uint8_t day) {
+    atomic_set(&shown_date, SIMULATION_DATE(year, month, day));
+}
+
+#if defined(CONFIG_ZW_SLEEP)
+/* SIMULATION_SET_ACCEL
+ * Set an axis of the emulated accelerometer, in milli-g. The value is in m/s^2 with a range of
+ * 2^5, so it is a q31 with the shift of 5.
+ */
+static void simulation_set_accel(enum sensor_channel channel, int32_t milli_g) {
+    struct sensor_chan_spec spec = { .chan_type = channel, .chan_idx = 0 };
+    q31_t value = (q31_t)((int64_t)milli_g * SENSOR_G / 1000 * (1LL << 26) / 1000000);
+    emul_sensor_backend_set_channel(EMUL_DT_GET(DT_ALIAS(accel0)), spec, &value, 5);
+}
+
+/* SIMULATION_MOVE_WRIST
+ * Hold the watch still at night and move it during the day.
+ */
+static void simulation_move_wrist(uint8_t hour) {
+    bool night = hour >= SIMULATION_NIGHT_START_H || hour < SIMULATION_NIGHT_END_H;
+    simulation_set_accel(SENSOR_CHAN_ACCEL_X, night ? 0 : SIMULATION_DAY_SWING_MG);
+    simulation_set_accel(SENSOR_CHAN_ACCEL_Y, 0);
+    simulation_set_accel(SENSOR_CHAN_ACCEL_Z, 1000);
+}
+
+/* SIMULATION_SLEEP_EPOCHS
+ * Sum the sleep epochs of the records kept in the history.
+ */
+static uint32_t simulation_sleep_epochs() {
+    history_record_t record;
+    uint32_t epochs = 0;
+    for (uint32_t seq = history_first_seq(); seq != history_next_seq(); seq++) {
+        if (history_read(seq, &record) == 0) {
+            epochs += record.flags & HISTORY_FLAG_SLEEP_EPOCHS_MASK;
+        }
+    }
+    return epochs;
+}
+#endif
+
+/* SIMULATION_REPORT
+ * Print the results so far.
+ */
+static void simulation_report(uint32_t elapsed_s) {
+    uint32_t elapsed_h = elapsed_s / 3600;
+
+    LOG_INF("Simulated %u h %u min: clock error %d s (max %d s), rollovers %u (missed %u).",
+            elapsed_h, (elapsed_s / 60) % 60, clock_error_s, max_clock_error_s,
+            rollovers, missed_rollovers);
+    for (int i = 0; i < SIMULATION_WAKEUP_COUNT; i++) {
+        uint32_t count = (uint32_t)atomic_get(&wakeups[i]);
+        LOG_INF("Wakeups of %s: %u (%u/h).", wakeup_names[i], count, elapsed_h ? count / elapsed_h : count);
+    }
+#if defined(CONFIG_ZW_SLEEP)
+    LOG_INF("Sleep epochs in the history: %u.", simulation_sleep_epochs());
+#endif
+    if (IS_ENABLED(CONFIG_ZW_LVGL_MEM_POOLS)) {
+        ui_mem_pools_report();
+    }
+}
+
+/* SIMULATION_CHECK_WORKER
+ * Compare the device clock with the simulated time and the date on the screen with the device
+ * clock. It ends the simulation when the configured duration is reached.
+ */
+static void simulation_check_worker(struct k_work *work) {
+    uint32_t elapsed_s = (uint32_t)((k_uptime_get() - start_uptime_ms) / MSEC_PER_SEC);
+    device_twin_t *device_twin = get_device_twin_instance();
+
+    // Clock error against the simulated time.
+    clock_error_s = (int32_t)(device_twin->unix_time - (CONFIG_ZW_SIMULATION_START_UNIX_TIME + elapsed_s));
+    if (abs(clock_error_s) > abs(max_clock_error_s)) {
+        max_clock_error_s = clock_error_s;
+    }
+
+    // A new day on the device clock has to be on the screen after the grace time.
+    datetime_t local_time = unix_to_localtime(device_twin->unix_time, device_twin->utc_zone);
+    uint32_t date = SIMULATION_DATE(local_time.year, local_time.month, local_time.day);
+    if (date != device_date) {
+        device_date = date;
+        device_date_missed = false;
+        rollovers++;
+    }
+    uint32_t seconds_of_day = local_time.hour * 3600 + local_time.minute * 60 + local_time.second;
+    if (IS_ENABLED(CONFIG_ZW_USERINTERFACE) && !device_date_missed &&
+        seconds_of_day >= SIMULATION_ROLLOVER_GRACE_S && (uint32_t)atomic_get(&shown_date) != date) {
+        device_date_missed = true;
+        missed_rollovers++;
+        LOG_WRN("Date rollover to %04u-%02u-%02u is missed.", local_time.year, local_time.month, local_time.day);
+    }
+#if defined(CONFIG_ZW_SLEEP)
+    simulation_move_wrist(local_time.hour);
+#endif
+
+    if (elapsed_s >= CONFIG_ZW_SIMULATION_DURATION_HOURS * 3600U) {
+        bool failed = missed_rollovers > 0;
+        simulation_report(elapsed_s);
+        if (IS_ENABLED(CONFIG_ZW_BENCHMARK)) {
+            benchmark_report_all();
+        }
+#if defined(CONFIG_ZW_POWER)
+        // The estimated current is checked against the budget like a missed rollover.
+        power_report();
+        uint32_t current_ua = power_average_current_ua();
+        if (CONFIG_ZW_SIMULATION_POWER_BUDGET_UA && current_ua > CONFIG_ZW_SIMULATION_POWER_BUDGET_UA) {
+            LOG_WRN("Average current %u uA is above the budget of %u uA.", current_ua,
+                    CONFIG_ZW_SIMULATION_POWER_BUDGET_UA);
+            failed = true;
+        }
+#endif
+        // Flush the deferred logs before leaving, the exit code tells if a check failed.
+        LOG_PANIC();
+        posix_exit(failed ? 1 : 0);
+        return;
+    }
+
+    if (elapsed_s % (CONFIG_ZW_SIMULATION_REPORT_INTERVAL_MIN * 60U) < SIMULATION_CHECK_INTERVAL_S) {
+        simulation_report(elapsed_s);
+    }
+    k_work_schedule(&simulation_check_work, K_SECONDS(SIMULATION_CHECK_INTERVAL_S));
+}
@@ -0,0 +1,40 @@
+/** Simulation Subsystem for ZephyrWatch.
+ * Time-warp soak runs on native_sim: the firmware runs days of watch operation in minutes while
+ * the clock error, the date rollovers and the wakeups are tracked and reported at the end.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#ifndef _SIMULATION_H
+#define _SIMULATION_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Sources of the wakeups counted during the simulation. */
+typedef enum {
+    SIMULATION_WAKEUP_RTC_ISR,
+    SIMULATION_WAKEUP_CLOCK_WORKER,
+    SIMULATION_WAKEUP_DATE_WORKER,
+    SIMULATION_WAKEUP_MAIN_LOOP,
+    SIMULATION_WAKEUP_COUNT,
+} simulation_wakeup_t;
+
+/* Set the start time and begin monitoring. The device twin has to be created before. */
+int enable_simulation_subsystem();
+
+/* Count a wakeup of the given source. Safe to call from ISRs. */
+void simulation_note_wakeup(simulation_wakeup_t source);
+
+/* Record the date shown on the home screen, to detect the missed rollovers. */
+void simulation_note_date_shown(uint16_t year, uint8_t month, uint8_t day);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
@@ -0,0 +1,159 @@
+/** Sleep Tracking Subsystem for ZephyrWatch.
+ * Every sample is converted to milli-g with integers, and its Euclidean norm minus 1 g (ENMO)
+ * above a noise floor is summed into the epoch. An epoch is scored once the two epochs after it
+ * are known. The accelerometer runs at the lowest rate the counts need, which keeps it in the
+ * low power mode; the raw samples are never stored.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/sys/atomic.h>
+
+#include "power/power.h"
+#include "sleep/sleep.h"
+
+LOG_MODULE_REGISTER(ZephyrWatch_Sleep, CONFIG_ZW_LOG_LEVEL);
+
+// Get the accelerometer from the device tree.
+#define SLEEP_ACCEL_DEVICE DT_ALIAS(accel0)
+
+#define SLEEP_EPOCH_S 30
+#define SLEEP_SAMPLES_PER_EPOCH (CONFIG_ZW_SLEEP_SAMPLE_HZ * SLEEP_EPOCH_S)
+#define SLEEP_ONE_G_MG 1000
+// Scored epoch in the window: the fifth one, after A-4 to A-1.
+#define SLEEP_SCORED_EPOCH 4
+
+// Cole-Kripke weights of A-4 ... A+2 for 30-second epochs, in ten-thousandths. The epoch is
+// sleep when the weighted sum stays below the threshold.
+static const uint16_t cole_kripke_weights[SLEEP_WINDOW_EPOCHS] = { 50, 30, 14, 28, 121, 8, 50 };
+
+// Activity counts of the last epochs, the oldest first.
+static uint16_t epoch_counts[SLEEP_WINDOW_EPOCHS];
+static uint8_t epochs_seen;
+static uint32_t epoch_sum;
+static uint32_t epoch_samples;
+static atomic_t sleep_epochs;
+
+static void sleep_sample_worker(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(sleep_sample_work, sleep_sample_worker);
+
+/* ISQRT
+ * Integer square root, rounded down.
+ */
+static uint32_t isqrt(uint64_t value) {
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+    while (bit > value) bit >>= 2;
+    while (bit) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
+
+/* TO_MILLI_G
+ * Convert an acceleration in m/s^2 to milli-g.
+ */
+static int32_t to_milli_g(const struct sensor_value *value) {
+    return (int32_t)(sensor_value_to_micro(value) / (SENSOR_G / SLEEP_ONE_G_MG));
+}
+
+/* SLEEP_SCORE_WINDOW
+ * Weighted sum of the window against the threshold, all in integers.
+ */
+int sleep_score_window(const uint16_t counts[SLEEP_WINDOW_EPOCHS]) {
+    uint32_t score = 0;
+    for (int i = 0; i < SLEEP_WINDOW_EPOCHS; i++) {
+        score += cole_kripke_weights[i] * counts[i];
+    }
+    return score < CONFIG_ZW_SLEEP_WAKE_THRESHOLD ? 1 : 0;
+}
+
+/* SLEEP_TAKE_EPOCHS
+ * Read and clear the sleep epoch counter.
+ */
+uint32_t sleep_take_epochs() {
+    return (uint32_t)atomic_clear(&sleep_epochs);
+}
+
+/* CLOSE_EPOCH
+ * Shift the count of the finished epoch into the window and score the one with two after it.
+ */
+static void close_epoch() {
+    uint32_t count = epoch_sum / CONFIG_ZW_SLEEP_SAMPLE_HZ;
+    memmove(epoch_counts, epoch_counts + 1, sizeof(epoch_counts) - sizeof(epoch_counts[0]));
+    epoch_counts[SLEEP_WINDOW_EPOCHS - 1] = MIN(count, UINT16_MAX);
+    epoch_sum = 0;
+    epoch_samples = 0;
+
+    // The first epochs have no full history, they are scored with zeros before them.
+    if (epochs_seen < SLEEP_WINDOW_EPOCHS - SLEEP_SCORED_EPOCH - 1) {
+        epochs_seen++;
+        return;
+    }
+    int asleep = sleep_score_window(epoch_counts);
+    if (asleep) {
+        atomic_inc(&sleep_epochs);
+    }
+    LOG_DBG("Epoch activity %u, %s.", epoch_counts[SLEEP_SCORED_EPOCH], asleep ? "sleep" : "wake");
+}
+
+/* SLEEP_SAMPLE_WORKER
+ * Add the activity of a sample to the epoch.
+ */
+static void sleep_sample_worker(struct k_work *work) {
+    const struct device *accel_dev = DEVICE_DT_GET(SLEEP_ACCEL_DEVICE);
+    struct sensor_value accel[3];
+
+    k_work_schedule(&sleep_sample_work, K_MSEC(MSEC_PER_SEC / CONFIG_ZW_SLEEP_SAMPLE_HZ));
+    if (sensor_sample_fetch_chan(accel_dev, SENSOR_CHAN_ACCEL_XYZ) ||
+        sensor_channel_get(accel_dev, SENSOR_CHAN_ACCEL_XYZ, accel)) {
+        return;
+    }
+
+    int64_t x = to_milli_g(&accel[0]);
+    int64_t y = to_milli_g(&accel[1]);
+    int64_t z = to_milli_g(&accel[2]);
+    int32_t enmo = (int32_t)isqrt(x * x + y * y + z * z) - SLEEP_ONE_G_MG - CONFIG_ZW_SLEEP_NOISE_MG;
+    if (enmo > 0) {
+        epoch_sum += enmo;
+    }
+
+    if (++epoch_samples >= SLEEP_SAMPLES_PER_EPOCH) {
+        close_epoch();
+    }
+}
+
+/* ENABLE_SLEEP_SUBSYSTEM
+ * Set the accelerometer rate and start the sampling.
+ */
+int enable_sleep_subsystem() {
+    const struct device *accel_dev = DEVICE_DT_GET(SLEEP_ACCEL_DEVICE);
+    if (!device_is_ready(accel_dev)) {
+        LOG_ERR("Accelerometer is not ready.");
+        return -ENODEV;
+    }
+
+    // The drivers round the rate up to their nearest one, the lowest that still gives the counts.
+    struct sensor_value rate = { .val1 = CONFIG_ZW_SLEEP_SAMPLE_HZ };
+    int ret = sensor_attr_set(accel_dev, SENSOR_CHAN_ACCEL_XYZ, SENSOR_ATTR_SAMPLING_FREQUENCY, &rate);
+    if (ret) {
+        LOG_WRN("Accelerometer rate couldn't be set to %d Hz. (RET: %d)", CONFIG_ZW_SLEEP_SAMPLE_HZ, ret);
+    }
+    if (IS_ENABLED(CONFIG_ZW_POWER)) power_state_set(POWER_DOMAIN_IMU, POWER_STATE_IMU_LOW_POWER);
+
+    k_work_schedule(&sleep_sample_work, K_NO_WAIT);
+    LOG_DBG("Sleep tracking is sampling at %d Hz.", CONFIG_ZW_SLEEP_SAMPLE_HZ);
+    return 0;
+}
@@ -0,0 +1,35 @@
+/** Sleep Tracking Subsystem for ZephyrWatch.
+ * Reduces the accelerometer samples to an activity count per 30-second epoch while they arrive,
+ * and scores each epoch as sleep or wake with the Cole-Kripke weights. Only the number of sleep
+ * epochs is kept, it goes into the activity history.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#ifndef _SLEEP_H
+#define _SLEEP_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Number of the epochs in the Cole-Kripke window: four before, the scored one, two after. */
+#define SLEEP_WINDOW_EPOCHS 7
+
+/* Put the accelerometer into its low power rate and start the sampling. */
+int enable_sleep_subsystem();
+
+/* Score the middle epoch of the window. Returns 1 for sleep, 0 for wake. */
+int sleep_score_window(const uint16_t counts[SLEEP_WINDOW_EPOCHS]);
+
+/* Number of the epochs scored as sleep since the last call. */
+uint32_t sleep_take_epochs();
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
@@ -0,0 +1,374 @@
+/** Storage Subsystem for ZephyrWatch.
+ * The deferred store replaces the settings backend (NVS) as the destination of the saves. A save
+ * only copies the value into a pending entry; a later save of the same name overwrites it, so a
+ * value changed several times during pairing is written once. The pending entries are written to
+ * the backend by a low priority work queue. The flush waits for the connections to end and for a
+ * quiet time without saves, but never longer than the maximum latency after the first pending
+ * save. The saves which do not fit into an entry go to the overflow heap and are flushed with
+ * them, or right away when the heap is nearly full. The deferred store is also a load source after
+ * the backend, so the loads see the pending values.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/slist.h>
+#if defined(CONFIG_BT_CONN)
+#include <zephyr/bluetooth/conn.h>
+#endif
+
+#include "benchmark/benchmark.h"
+#include "storage/storage.h"
+
+LOG_MODULE_REGISTER(ZephyrWatch_Storage, CONFIG_ZW_LOG_LEVEL);
+
+#define STORAGE_STACK_SIZE 2048
+
+typedef struct {
+    bool used;
+    char name[SETTINGS_MAX_NAME_LEN + 1];
+    uint8_t value[CONFIG_ZW_STORAGE_VALUE_MAX];
+    size_t length;
+} storage_entry_t;
+
+// A save which did not fit into the table, waiting for the next flush.
+typedef struct {
+    sys_snode_t node;
+    char name[SETTINGS_MAX_NAME_LEN + 1];
+    size_t length;
+    uint8_t value[];
+} storage_overflow_t;
+
+static storage_entry_t pending[CONFIG_ZW_STORAGE_ENTRIES];
+static sys_slist_t overflow = SYS_SLIST_STATIC_INIT(&overflow);
+static K_HEAP_DEFINE(overflow_heap, CONFIG_ZW_STORAGE_OVERFLOW_SIZE);
+static size_t overflow_used;
+static int64_t first_pending_ms;
+static atomic_t connections;
+static atomic_t flash_activity;
+
+// Above this many bytes on the overflow heap the flush is not deferred any more, so the next large
+// saves still find room instead of being written through in the caller's thread.
+#define OVERFLOW_FLUSH_THRESHOLD (CONFIG_ZW_STORAGE_OVERFLOW_SIZE * 3 / 4)
+
+// Serializes the pending entries and the writes to the backend. The settings lock is always
+// taken before it: the settings core holds it around the saves and the loads.
+static K_MUTEX_DEFINE(storage_lock);
+static struct settings_store *backend_store;
+static struct settings_store deferred_store;
+
+static struct k_work_q storage_work_q;
+static K_THREAD_STACK_DEFINE(storage_stack_area, STORAGE_STACK_SIZE);
+static void storage_flush_worker(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(storage_flush_work, storage_flush_worker);
+
+#if defined(CONFIG_ZW_STORAGE_STATS)
+static BENCHMARK_METRIC_DEFINE(flash_write_time, "Settings flash write", "ms");
+static BENCHMARK_METRIC_DEFINE(flush_entries, "Settings entries per flush", "entries");
+static BENCHMARK_METRIC_DEFINE(flush_latency, "Settings save to flush", "ms");
+static BENCHMARK_METRIC_DEFINE(overflow_saves, "Settings saves on the overflow heap", "saves");
+static BENCHMARK_METRIC_DEFINE(write_through, "Settings written through", "saves");
+#endif
+
+/* __WRAP_SETTINGS_DST_REGISTER
+ * The backend registers itself as the destination of the saves during the settings init. Keep
+ * it as the backend of the deferred store, which takes its place once the subsystem is enabled.
+ */
+void __real_settings_dst_register(struct settings_store *cs);
+void __wrap_settings_dst_register(struct settings_store *cs) {
+    if (cs != &deferred_store) {
+        backend_store = cs;
+    }
+    __real_settings_dst_register(cs);
+}
+
+/* BACKEND_SAVE
+ * Write an entry to the backend. Called with the settings and the storage locks held.
+ */
+static int backend_save(const char *name, const void *value, size_t length) {
+    atomic_inc(&flash_activity);
+#if defined(CONFIG_ZW_STORAGE_STATS)
+    int64_t start_ms = k_uptime_get();
+#endif
+    int ret = backend_store->cs_itf->csi_save(backend_store, name, value, length);
+#if defined(CONFIG_ZW_STORAGE_STATS)
+    benchmark_metric_record(&flash_write_time, (uint32_t)(k_uptime_get() - start_ms));
+#endif
+    atomic_inc(&flash_activity);
+    if (ret) {
+        LOG_ERR("Writing %s failed (err %d).", name, ret);
+    }
+    return ret;
+}
+
+/* FLUSH_PENDING
+ * Write the table and the overflow entries to the backend. Called with both locks held.
+ */
+static uint32_t flush_pending(int *ret) {
+    uint32_t count = 0;
+    for (int i = 0; i < ARRAY_SIZE(pending); i++) {
+        if (!pending[i].used) continue;
+        int err = backend_save(pending[i].name, pending[i].length ? pending[i].value : NULL, pending[i].length);
+        if (err) *ret = err;
+        pending[i].used = false;
+        count++;
+    }
+    sys_snode_t *node;
+    while ((node = sys_slist_get(&overflow)) != NULL) {
+        storage_overflow_t *entry = CONTAINER_OF(node, storage_overflow_t, node);
+        int err = backend_save(entry->name, entry->length ? entry->value : NULL, entry->length);
+        if (err) *ret = err;
+        overflow_used -= sizeof(storage_overflow_t) + entry->length;
+        k_heap_free(&overflow_heap, entry);
+        count++;
+    }
+    first_pending_ms = 0;
+    return count;
+}
+
+/* REMOVE_OVERFLOW
+ * Drop the overflow entry of a name, if any. Called with the storage lock held.
+ */
+static void remove_overflow(const char *name) {
+    storage_overflow_t *entry, *prev = NULL;
+    SYS_SLIST_FOR_EACH_CONTAINER(&overflow, entry, node) {
+        if (strcmp(entry->name, name) == 0) {
+            sys_slist_remove(&overflow, prev ? &prev->node : NULL, &entry->node);
+            overflow_used -= sizeof(storage_overflow_t) + entry->length;
+            k_heap_free(&overflow_heap, entry);
+            return;
+        }
+        prev = entry;
+    }
+}
+
+/* SCHEDULE_FLUSH
+ * Move the flush to the end of the quiet time, or to the latency bound when it comes first or
+ * when a peer is connected. Called with the storage lock held and some entry pending.
+ */
+static void schedule_flush(int64_t now_ms) {
+    int64_t flush_ms = first_pending_ms + CONFIG_ZW_STORAGE_MAX_LATENCY_MS;
+    if (atomic_get(&connections) == 0) {
+        flush_ms = MIN(flush_ms, now_ms + CONFIG_ZW_STORAGE_QUIET_MS);
+    }
+    k_work_reschedule_for_queue(&storage_work_q, &storage_flush_work, K_MSEC(MAX(flush_ms - now_ms, 0)));
+}
+
+/* DEFERRED_SAVE
+ * Keep the value in its pending entry. Deletes are saves with no value. Called by the settings
+ * core with the settings lock held.
+ */
+static int deferred_save(struct settings_store *cs, const char *name, const char *value, size_t val_len) {
+    storage_entry_t *entry = NULL;
+    int64_t now_ms = k_uptime_get();
+    int ret = 0;
+
+    if (strlen(name) > SETTINGS_MAX_NAME_LEN) return -EINVAL;
+
+    k_mutex_lock(&storage_lock, K_FOREVER);
+    for (int i = 0; i < ARRAY_SIZE(pending); i++) {
+        if (pending[i].used && strcmp(pending[i].name, name) == 0) {
+            entry = &pending[i];
+            break;
+        }
+        if (!pending[i].used && entry == NULL) {
+            entry = &pending[i];
+        }
+    }
+    remove_overflow(name);
+    if (first_pending_ms == 0) {
+        first_pending_ms = now_ms;
+    }
+
+    if (entry != NULL && val_len <= CONFIG_ZW_STORAGE_VALUE_MAX) {
+        if (!entry->used) {
+            entry->used = true;
+            strcpy(entry->name, name);
+        }
+        if (val_len) memcpy(entry->value, value, val_len);
+        entry->length = val_len;
+        schedule_flush(now_ms);
+        k_mutex_unlock(&storage_lock);
+        return 0;
+    }
+
+    // Too large or no free entry: the older value of the name must not be written after this one.
+    if (entry != NULL && entry->used) {
+        entry->used = false;
+    }
+    storage_overflow_t *extra = k_heap_alloc(&overflow_heap, sizeof(storage_overflow_t) + val_len, K_NO_WAIT);
+    if (extra != NULL) {
+        strcpy(extra->name, name);
+        if (val_len) memcpy(extra->value, value, val_len);
+        extra->length = val_len;
+        sys_slist_append(&overflow, &extra->node);
+        overflow_used += sizeof(storage_overflow_t) + val_len;
+        if (overflow_used > OVERFLOW_FLUSH_THRESHOLD) {
+            k_work_reschedule_for_queue(&storage_work_q, &storage_flush_work, K_NO_WAIT);
+        } else {
+            schedule_flush(now_ms);
+        }
+#if defined(CONFIG_ZW_STORAGE_STATS)
+        benchmark_metric_record(&overflow_saves, 1);
+#endif
+        k_mutex_unlock(&storage_lock);
+        return 0;
+    }
+
+    // The overflow heap is full as well: write everything here, in the order of the saves.
+    flush_pending(&ret);
+    int err = backend_save(name, value, val_len);
+#if defined(CONFIG_ZW_STORAGE_STATS)
+    benchmark_metric_record(&write_through, 1);
+#endif
+    k_mutex_unlock(&storage_lock);
+    return err ? err : ret;
+}
+
+typedef struct {
+    const uint8_t *value;
+    size_t length;
+} pending_value_t;
+
+static ssize_t read_pending_value(void *cb_arg, void *data, size_t len) {
+    const pending_value_t *pending_value = cb_arg;
+    size_t length = MIN(len, pending_value->length);
+    memcpy(data, pending_value->value, length);
+    return length;
+}
+
+/* DEFERRED_LOAD
+ * Give the pending values to the handlers. The deferred store is loaded after the backend, so
+ * they override the older values in the flash. Called by the settings core with the settings
+ * lock held.
+ */
+static int deferred_load(struct settings_store *cs, const struct settings_load_arg *arg) {
+    k_mutex_lock(&storage_lock, K_FOREVER);
+    for (int i = 0; i < ARRAY_SIZE(pending); i++) {
+        if (!pending[i].used) continue;
+        if (arg && arg->subtree && !settings_name_steq(pending[i].name, arg->subtree, NULL)) continue;
+        pending_value_t pending_value = { pending[i].value, pending[i].length };
+        settings_call_set_handler(pending[i].name, pending[i].length, read_pending_value, &pending_value, arg);
+    }
+    storage_overflow_t *extra;
+    SYS_SLIST_FOR_EACH_CONTAINER(&overflow, extra, node) {
+        if (arg && arg->subtree && !settings_name_steq(extra->name, arg->subtree, NULL)) continue;
+        pending_value_t pending_value = { extra->value, extra->length };
+        settings_call_set_handler(extra->name, extra->length, read_pending_value, &pending_value, arg);
+    }
+    k_mutex_unlock(&storage_lock);
+    return 0;
+}
+
+static int deferred_save_start(struct settings_store *cs) {
+    return backend_store->cs_itf->csi_save_start ? backend_store->cs_itf->csi_save_start(backend_store) : 0;
+}
+
+static int deferred_save_end(struct settings_store *cs) {
+    return backend_store->cs_itf->csi_save_end ? backend_store->cs_itf->csi_save_end(backend_store) : 0;
+}
+
+static void *deferred_storage_get(struct settings_store *cs) {
+    return backend_store->cs_itf->csi_storage_get ? backend_store->cs_itf->csi_storage_get(backend_store) : NULL;
+}
+
+static const struct settings_store_itf deferred_itf = {
+    .csi_load = deferred_load,
+    .csi_save_start = deferred_save_start,
+    .csi_save = deferred_save,
+    .csi_save_end = deferred_save_end,
+    .csi_storage_get = deferred_storage_get,
+};
+
+static struct settings_store deferred_store = { .cs_itf = &deferred_itf };
+
+/* ENABLE_STORAGE_SUBSYSTEM
+ * Start the writer and register the deferred store as the destination of the saves, and as the
+ * last source of the loads.
+ */
+int enable_storage_subsystem() {
+    int ret = settings_subsys_init();
+    if (ret) {
+        LOG_ERR("Settings subsystem couldn't be initialized. (RET: %d)", ret);
+        return ret;
+    }
+    if (backend_store == NULL) {
+        LOG_ERR("Settings subsystem has no backend.");
+        return -ENODEV;
+    }
+
+    k_work_queue_start(&storage_work_q, storage_stack_area, K_THREAD_STACK_SIZEOF(storage_stack_area),
+                       K_LOWEST_APPLICATION_THREAD_PRIO, NULL);
+    settings_src_register(&deferred_store);
+    settings_dst_register(&deferred_store);
+    LOG_DBG("Settings saves are deferred up to %d ms.", CONFIG_ZW_STORAGE_MAX_LATENCY_MS);
+    return 0;
+}
+
+/* STORAGE_FLUSH
+ * Write the pending entries in one batch, under the settings lock like the other writes to the
+ * backend.
+ */
+int storage_flush() {
+    int ret = 0;
+
+    settings_lock_take();
+    k_mutex_lock(&storage_lock, K_FOREVER);
+#if defined(CONFIG_ZW_STORAGE_STATS)
+    int64_t first_ms = first_pending_ms;
+#endif
+    uint32_t count = flush_pending(&ret);
+#if defined(CONFIG_ZW_STORAGE_STATS)
+    if (count) {
+        benchmark_metric_record(&flush_entries, count);
+        benchmark_metric_record(&flush_latency, (uint32_t)(k_uptime_get() - first_ms));
+    }
+#endif
+    k_mutex_unlock(&storage_lock);
+    settings_lock_release();
+
+    if (count) LOG_DBG("%u settings entries are written.", count);
+    return ret;
+}
+
+/* STORAGE_FLASH_ACTIVITY
+ * Read the flash write counter.
+ */
+uint32_t storage_flash_activity() {
+    return (uint32_t)atomic_get(&flash_activity);
+}
+
+/* STORAGE_FLUSH_WORKER
+ * Runs on the storage work queue when the flush is due.
+ */
+static void storage_flush_worker(struct k_work *work) {
+    storage_flush();
+}
+
+#if defined(CONFIG_BT_CONN)
+static void process_connection(struct bt_conn *conn, uint8_t err) {
+    if (!err) atomic_inc(&connections);
+}
+
+static void process_disconnection(struct bt_conn *conn, uint8_t reason) {
+    atomic_dec(&connections);
+
+    // The saves of the connection can be written after the quiet time from now on.
+    k_mutex_lock(&storage_lock, K_FOREVER);
+    if (first_pending_ms) {
+        schedule_flush(k_uptime_get());
+    }
+    k_mutex_unlock(&storage_lock);
+}
+
+BT_CONN_CB_DEFINE(storage_connection_callbacks) = {
+    .connected = process_connection,
+    .disconnected = process_disconnection,
+};
+#endif
@@ -0,0 +1,36 @@
+/** Storage Subsystem for ZephyrWatch.
+ * Defers the settings writes. The subsystem sits in front of the settings backend, so the
+ * writes of the Bluetooth host (keys, CCC configurations, the GATT database hash) and of the
+ * application are kept in RAM and written to the flash in one batch later: when there is no
+ * connection and no write came for a while, or at the latest after a fixed delay. The loads see
+ * the values which are not written yet.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#ifndef _STORAGE_H
+#define _STORAGE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Initialize the settings subsystem and put the deferred store in front of its backend. */
+int enable_storage_subsystem();
+
+/* Write all the pending entries to the flash now. */
+int storage_flush();
+
+/* Counter bumped at the start and at the end of every flash write. A change over a time window
+ * means a flash write overlapped it.
+ */
+uint32_t storage_flash_activity();
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
@@ -0,0 +1,275 @@
+/** Touch Subsystem for ZephyrWatch.
+ * It replaces the CST816S input driver of Zephyr for the same devicetree node, so the LVGL
+ * pointer still gets the touches through the input subsystem. The controller only interrupts on
+ * a press, a release and a recognized gesture (and on the moves while touched if dragging is
+ * enabled), and every interrupt is one burst read of the touch registers.
+ *
+ * LVGL would detect the same double tap from the two clicks, so a press shortly after a release
+ * is not passed to it; the double tap comes from the controller only.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#define DT_DRV_COMPAT hynitron_cst816s
+
+#include <errno.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/input/input.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+
+#include "benchmark/benchmark.h"
+#include "touch/touch.h"
+
+LOG_MODULE_REGISTER(ZephyrWatch_Touch, CONFIG_ZW_LOG_LEVEL);
+
+#define TOUCH_NODE DT_INST(0, DT_DRV_COMPAT)
+
+// Registers of the controller.
+#define CST816S_REG_GESTURE_ID 0x01
+#define CST816S_REG_CHIP_ID 0xA7
+#define CST816S_REG_MOTION_MASK 0xEC
+#define CST816S_REG_AUTO_SLEEP_TIME 0xF9
+#define CST816S_REG_IRQ_CTL 0xFA
+#define CST816S_REG_DIS_AUTO_SLEEP 0xFE
+
+#define CST816S_GESTURE_SLIDE_UP 0x01
+#define CST816S_GESTURE_SLIDE_DOWN 0x02
+#define CST816S_GESTURE_SLIDE_LEFT 0x03
+#define CST816S_GESTURE_SLIDE_RIGHT 0x04
+#define CST816S_GESTURE_SINGLE_CLICK 0x05
+#define CST816S_GESTURE_DOUBLE_CLICK 0x0B
+
+#define CST816S_MOTION_EN_DCLICK BIT(0)
+#define CST816S_IRQ_EN_TOUCH BIT(6)
+#define CST816S_IRQ_EN_CHANGE BIT(5)
+#define CST816S_IRQ_EN_MOTION BIT(4)
+
+// Gesture, finger count, X high/low, Y high/low.
+#define TOUCH_READ_LENGTH 6
+#define TOUCH_RESET_MS 5
+#define TOUCH_STARTUP_MS 50
+#define TOUCH_GESTURE_QUEUE 8
+// Seconds without a touch before the controller goes into its low power scanning.
+#define TOUCH_STANDBY_AUTO_SLEEP_S 1
+
+#define TOUCH_IRQ_NORMAL (CST816S_IRQ_EN_CHANGE | CST816S_IRQ_EN_MOTION | \
+                          (IS_ENABLED(CONFIG_ZW_TOUCH_DRAG) ? CST816S_IRQ_EN_TOUCH : 0))
+
+static const struct device *touch_dev = DEVICE_DT_GET(TOUCH_NODE);
+static const struct i2c_dt_spec touch_i2c = I2C_DT_SPEC_GET(TOUCH_NODE);
+static const struct gpio_dt_spec touch_irq = GPIO_DT_SPEC_GET(TOUCH_NODE, irq_gpios);
+static const struct gpio_dt_spec touch_rst = GPIO_DT_SPEC_GET_OR(TOUCH_NODE, rst_gpios, {0});
+static struct gpio_callback touch_irq_callback;
+
+K_MSGQ_DEFINE(touch_gestures, sizeof(touch_gesture_t), TOUCH_GESTURE_QUEUE, 4);
+
+static bool enabled;
+static bool pressed;
+static bool swallowing;
+static bool standby;
+static int64_t released_at_ms;
+// Interrupts since the last read, counted in the ISR.
+static atomic_t pending_irqs;
+
+#if defined(CONFIG_ZW_BENCHMARK)
+// Interrupts (and so I2C reads) from a press to its release.
+static BENCHMARK_METRIC_DEFINE(touch_reads_per_touch, "Touch reads per touch", "reads");
+static uint32_t touch_reads;
+#endif
+
+static void touch_read_worker(struct k_work *work);
+static K_WORK_DEFINE(touch_read_work, touch_read_worker);
+
+/* QUEUE_GESTURE
+ * Pass a gesture to the user interface. When the queue is full, the gesture is dropped.
+ */
+static void queue_gesture(touch_gesture_type_t type, uint16_t x, uint16_t y) {
+    touch_gesture_t gesture = { .type = type, .x = x, .y = y };
+    if (k_msgq_put(&touch_gestures, &gesture, K_NO_WAIT)) {
+        LOG_WRN("Touch gesture %d is dropped.", type);
+    }
+}
+
+/* TOUCH_EDGE
+ * Report a press or a release to the input subsystem. The touch that wakes the display up and the
+ * second tap of a double tap are swallowed.
+ */
+static void touch_edge(bool touching, uint16_t x, uint16_t y) {
+    pressed = touching;
+
+    if (touching) {
+        // The touch that wakes the display up is not a click.
+        if (standby) {
+            queue_gesture(TOUCH_GESTURE_WAKE, x, y);
+        }
+        swallowing = standby || k_uptime_get() - released_at_ms < CONFIG_ZW_TOUCH_DOUBLE_TAP_MS;
+    } else {
+        released_at_ms = k_uptime_get();
+#if defined(CONFIG_ZW_BENCHMARK)
+        benchmark_metric_record(&touch_reads_per_touch, touch_reads);
+        touch_reads = 0;
+#endif
+    }
+    if (swallowing) {
+        return;
+    }
+    input_report_abs(touch_dev, INPUT_ABS_X, x, false, K_FOREVER);
+    input_report_abs(touch_dev, INPUT_ABS_Y, y, false, K_FOREVER);
+    input_report_key(touch_dev, INPUT_BTN_TOUCH, touching, true, K_FOREVER);
+}
+
+/* TOUCH_READ_WORKER
+ * Read the touch registers once, queue the gesture and report the touch to the input subsystem.
+ */
+static void touch_read_worker(struct k_work *work) {
+    uint8_t data[TOUCH_READ_LENGTH];
+    atomic_val_t irqs = atomic_clear(&pending_irqs);
+    int ret = i2c_burst_read_dt(&touch_i2c, CST816S_REG_GESTURE_ID, data, sizeof(data));
+    if (ret) {
+        LOG_ERR("Touch registers couldn't be read. (RET: %d)", ret);
+        return;
+    }
+
+    uint16_t x = ((data[2] & 0x0F) << 8) | data[3];
+    uint16_t y = ((data[4] & 0x0F) << 8) | data[5];
+    bool touching = data[1] > 0;
+#if defined(CONFIG_ZW_BENCHMARK)
+    touch_reads++;
+#endif
+
+    bool gesture = true;
+    switch (data[0]) {
+    case CST816S_GESTURE_SLIDE_UP: queue_gesture(TOUCH_GESTURE_SWIPE_UP, x, y); break;
+    case CST816S_GESTURE_SLIDE_DOWN: queue_gesture(TOUCH_GESTURE_SWIPE_DOWN, x, y); break;
+    case CST816S_GESTURE_SLIDE_LEFT: queue_gesture(TOUCH_GESTURE_SWIPE_LEFT, x, y); break;
+    case CST816S_GESTURE_SLIDE_RIGHT: queue_gesture(TOUCH_GESTURE_SWIPE_RIGHT, x, y); break;
+    case CST816S_GESTURE_DOUBLE_CLICK: queue_gesture(TOUCH_GESTURE_DOUBLE_TAP, x, y); break;
+    default: gesture = false; break;
+    }
+
+    if (touching == pressed) {
+        // The press and the release both interrupted before this read, e.g. while the work queue
+        // was busy: no press was reported since the last release, yet two edges are pending.
+        // Report both at the position of the tap. The gesture register keeps the click of an
+        // earlier tap, so it is no proof of a new one, and a gesture is never a tap as well.
+        if (!touching && irqs > 1 && !gesture) {
+            touch_edge(true, x, y);
+            touch_edge(false, x, y);
+            return;
+        }
+        // A move while touched, or only a gesture.
+        if (touching && !swallowing && IS_ENABLED(CONFIG_ZW_TOUCH_DRAG)) {
+            input_report_abs(touch_dev, INPUT_ABS_X, x, false, K_FOREVER);
+            input_report_abs(touch_dev, INPUT_ABS_Y, y, true, K_FOREVER);
+        }
+        return;
+    }
+    touch_edge(touching, x, y);
+}
+
+static void touch_isr(const struct device *port, struct gpio_callback *callback, uint32_t pins) {
+    atomic_inc(&pending_irqs);
+    k_work_submit(&touch_read_work);
+}
+
+/* TOUCH_SET_STANDBY
+ * In standby, the controller goes into its low power scanning after a second without a touch
+ * and only interrupts on a touch. Otherwise, it keeps scanning at the normal rate.
+ */
+int touch_set_standby(bool enable) {
+    // The display is turned on before the controller is set up.
+    if (!enabled) {
+        return 0;
+    }
+    int ret = i2c_reg_write_byte_dt(&touch_i2c, CST816S_REG_IRQ_CTL,
+                                    enable ? CST816S_IRQ_EN_CHANGE : TOUCH_IRQ_NORMAL);
+    if (ret == 0 && enable) {
+        ret = i2c_reg_write_byte_dt(&touch_i2c, CST816S_REG_AUTO_SLEEP_TIME, TOUCH_STANDBY_AUTO_SLEEP_S);
+    }
+    if (ret == 0) {
+        ret = i2c_reg_write_byte_dt(&touch_i2c, CST816S_REG_DIS_AUTO_SLEEP, enable ? 0x00 : 0x01);
+    }
+    if (ret) {
+        LOG_ERR("Touch standby couldn't be %s. (RET: %d)", enable ? "entered" : "left", ret);
+        return ret;
+    }
+    standby = enable;
+    LOG_DBG("Touch standby is %s.", enable ? "entered" : "left");
+    return 0;
+}
+
+/* TOUCH_GET_GESTURE
+ * Take a gesture from the queue without waiting.
+ */
+int touch_get_gesture(touch_gesture_t *gesture) {
+    return k_msgq_get(&touch_gestures, gesture, K_NO_WAIT);
+}
+
+/* ENABLE_TOUCH_SUBSYSTEM
+ * Reset the controller, turn on the double tap recognition and the interrupt.
+ */
+int enable_touch_subsystem() {
+    int ret;
+    if (!device_is_ready(touch_i2c.bus) || !gpio_is_ready_dt(&touch_irq)) {
+        LOG_ERR("Touch controller bus is not ready.");
+        return -ENODEV;
+    }
+
+    if (touch_rst.port != NULL) {
+        gpio_pin_configure_dt(&touch_rst, GPIO_OUTPUT_ACTIVE);
+        k_msleep(TOUCH_RESET_MS);
+        gpio_pin_set_dt(&touch_rst, 0);
+        k_msleep(TOUCH_STARTUP_MS);
+    }
+
+    uint8_t chip_id;
+    ret = i2c_reg_read_byte_dt(&touch_i2c, CST816S_REG_CHIP_ID, &chip_id);
+    if (ret) {
+        LOG_ERR("Touch controller doesn't answer. (RET: %d)", ret);
+        return ret;
+    }
+
+    ret = i2c_reg_write_byte_dt(&touch_i2c, CST816S_REG_MOTION_MASK, CST816S_MOTION_EN_DCLICK);
+    if (ret) {
+        LOG_ERR("Touch double tap couldn't be enabled. (RET: %d)", ret);
+        return ret;
+    }
+    enabled = true;
+    ret = touch_set_standby(false);
+    if (ret) {
+        enabled = false;
+        return ret;
+    }
+
+    ret = gpio_pin_configure_dt(&touch_irq, GPIO_INPUT);
+    if (ret == 0) ret = gpio_pin_interrupt_configure_dt(&touch_irq, GPIO_INT_EDGE_TO_ACTIVE);
+    if (ret) {
+        LOG_ERR("Touch interrupt couldn't be configured. (RET: %d)", ret);
+        return ret;
+    }
+    gpio_init_callback(&touch_irq_callback, touch_isr, BIT(touch_irq.pin));
+    ret = gpio_add_callback(touch_irq.port, &touch_irq_callback);
+    if (ret) {
+        return ret;
+    }
+
+    LOG_DBG("Touch controller 0x%02x is ready, drag reporting %s.", chip_id,
+            IS_ENABLED(CONFIG_ZW_TOUCH_DRAG) ? "on" : "off");
+    return 0;
+}
+
+/* The device of the node, the LVGL pointer input listens to its events. The controller itself
+ * is set up by enable_touch_subsystem().
+ */
+static int touch_device_init(const struct device *dev) {
+    return 0;
+}
+
+DEVICE_DT_DEFINE(TOUCH_NODE, touch_device_init, NULL, NULL, NULL, POST_KERNEL,
+                 CONFIG_INPUT_INIT_PRIORITY, NULL);
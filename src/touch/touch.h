@@ -0,0 +1,50 @@
+/** Touch Subsystem for ZephyrWatch.
+ * Drives the CST816S touch controller of the watch. The controller recognizes the swipes and the
+ * double taps itself, they are queued for the user interface instead of being computed by LVGL
+ * from a stream of touch points. While the display is off, the controller scans in its low power
+ * mode and only wakes the CPU when touched.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#ifndef _TOUCH_H
+#define _TOUCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Gestures recognized by the controller. */
+typedef enum {
+    TOUCH_GESTURE_SWIPE_UP,
+    TOUCH_GESTURE_SWIPE_DOWN,
+    TOUCH_GESTURE_SWIPE_LEFT,
+    TOUCH_GESTURE_SWIPE_RIGHT,
+    TOUCH_GESTURE_DOUBLE_TAP,
+    TOUCH_GESTURE_WAKE, // A touch while in standby.
+} touch_gesture_type_t;
+
+typedef struct {
+    touch_gesture_type_t type;
+    uint16_t x;
+    uint16_t y;
+} touch_gesture_t;
+
+/* Reset the controller, enable its gesture recognition and its interrupt. */
+int enable_touch_subsystem();
+
+/* Take the next recognized gesture. Returns 0, or -EAGAIN if there is none. */
+int touch_get_gesture(touch_gesture_t *gesture);
+
+/* Put the controller into its low power scanning, or back to the normal one. */
+int touch_set_standby(bool standby);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
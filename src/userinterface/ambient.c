@@ -0,0 +1,146 @@
+/** Ambient Display implementation for LVGL-based UI.
+ * In the idle mode the panel only shows the most significant bit of each channel. The frames are
+ * quantized to these 8 colors in the draw buffer right before the flush, so the panel never gets
+ * a full color frame while it is in the mode. Entering the mode redraws the screen with the
+ * quantization first, then switches the panel; leaving it switches the panel first.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#include "lvgl.h"
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "userinterface/ambient.h"
+#include "userinterface/screens/home/home.h"
+#if defined(CONFIG_ZW_UI_BLEPAIRING)
+#include "userinterface/screens/blepairing/blepairing.h"
+#endif
+
+LOG_MODULE_REGISTER(ZephyrWatch_UI_Ambient, CONFIG_ZW_LOG_LEVEL);
+
+// How often the inactivity is checked.
+#define AMBIENT_PERIOD_MS 250
+
+// RGB565 channels and their most significant bits.
+#define RGB565_RED 0xF800
+#define RGB565_GREEN 0x07E0
+#define RGB565_BLUE 0x001F
+#define RGB565_RED_MSB 0x8000
+#define RGB565_GREEN_MSB 0x0400
+#define RGB565_BLUE_MSB 0x0010
+
+typedef enum {
+    AMBIENT_STATE_ACTIVE,
+    AMBIENT_STATE_IDLE,
+    AMBIENT_STATE_OFF,
+} ambient_state_t;
+
+static ambient_state_t ambient_state;
+static bool quantizing;
+
+/* UI_QUANTIZE_8_COLORS
+ * Every channel becomes fully on or off by its most significant bit, as the panel shows it.
+ */
+void ui_quantize_8_colors(uint16_t *pixels, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        uint16_t pixel = pixels[i];
+        pixels[i] = ((pixel & RGB565_RED_MSB) ? RGB565_RED : 0) |
+                    ((pixel & RGB565_GREEN_MSB) ? RGB565_GREEN : 0) |
+                    ((pixel & RGB565_BLUE_MSB) ? RGB565_BLUE : 0);
+    }
+}
+
+/* AMBIENT_FLUSH_EVENT
+ * Quantize the area in the draw buffer before it is flushed. The buffer is not byte swapped yet.
+ */
+static void ambient_flush_event(lv_event_t *event) {
+    lv_display_t *display = lv_event_get_target(event);
+    const lv_area_t *area = lv_event_get_param(event);
+    lv_draw_buf_t *buffer = lv_display_get_buf_active(display);
+    if (area == NULL || buffer == NULL || lv_display_get_color_format(display) != LV_COLOR_FORMAT_RGB565) {
+        return;
+    }
+
+    uint32_t width = lv_area_get_width(area);
+    for (int32_t row = 0; row < lv_area_get_height(area); row++) {
+        ui_quantize_8_colors((uint16_t *)(buffer->data + row * buffer->header.stride), width);
+    }
+}
+
+/* UI_DISPLAY_MODE_SET
+ * Add the quantization and redraw before the idle mode, remove it after leaving the mode.
+ */
+int ui_display_mode_set(display_mode_t mode) {
+    lv_display_t *display = lv_display_get_default();
+    bool idle = mode == DISPLAY_MODE_IDLE;
+
+    if (idle && !quantizing) {
+        lv_display_add_event_cb(display, ambient_flush_event, LV_EVENT_FLUSH_START, NULL);
+        quantizing = true;
+        lv_obj_invalidate(lv_screen_active());
+        lv_refr_now(display);
+    }
+
+    int ret = display_set_mode(mode);
+    if (ret) {
+        // The panel stays in its mode, so do the frames.
+        idle = display_get_mode() == DISPLAY_MODE_IDLE;
+    }
+
+    if (!idle && quantizing) {
+        lv_display_remove_event_cb_with_user_data(display, ambient_flush_event, NULL);
+        quantizing = false;
+        lv_obj_invalidate(lv_screen_active());
+    }
+    return ret;
+}
+
+/* AMBIENT_STEP
+ * Follow the inactivity: the ambient home screen first, then the display off. Any touch brings
+ * the full colors back.
+ */
+static void ambient_step(lv_timer_t *timer) {
+#if defined(CONFIG_ZW_UI_BLEPAIRING)
+    // The passkey stays on while the user types it on the phone, even if it came up while the
+    // display was off.
+    if (blepairing_screen != NULL && lv_screen_active() == blepairing_screen) {
+        if (ambient_state == AMBIENT_STATE_OFF) {
+            enable_display_subsystem();
+        }
+        lv_display_trigger_activity(NULL);
+    }
+#endif
+    uint32_t inactive_ms = lv_display_get_inactive_time(NULL);
+
+    if (inactive_ms < CONFIG_ZW_UI_AMBIENT_TIMEOUT_S * MSEC_PER_SEC) {
+        if (ambient_state != AMBIENT_STATE_ACTIVE) {
+            // A touch has already brought the full colors back, the pairing screen has not.
+            ui_display_mode_set(DISPLAY_MODE_FULL);
+            ambient_state = AMBIENT_STATE_ACTIVE;
+            LOG_DBG("Ambient display is left.");
+        }
+    } else if (ambient_state == AMBIENT_STATE_ACTIVE) {
+        // Tried once per inactivity, the panel may have no idle mode.
+        if (lv_screen_active() != home_screen && lv_obj_is_valid(home_screen)) {
+            lv_screen_load(home_screen);
+        }
+        ui_display_mode_set(DISPLAY_MODE_IDLE);
+        ambient_state = AMBIENT_STATE_IDLE;
+        LOG_DBG("Ambient display is entered.");
+    } else if (ambient_state == AMBIENT_STATE_IDLE && CONFIG_ZW_UI_SCREEN_OFF_S > 0 &&
+               inactive_ms >= CONFIG_ZW_UI_SCREEN_OFF_S * MSEC_PER_SEC) {
+        // The display is turned on again by a touch, through the touch subsystem.
+        if (disable_display_subsystem() == 0) {
+            ambient_state = AMBIENT_STATE_OFF;
+        }
+    }
+}
+
+/* UI_AMBIENT_INIT
+ * Start the inactivity timer.
+ */
+void ui_ambient_init() {
+    lv_timer_create(ambient_step, AMBIENT_PERIOD_MS, NULL);
+}
@@ -0,0 +1,33 @@
+/** Ambient Display interface for LVGL-based UI.
+ * Shows the home screen in the idle mode of the panel when the watch is not used, and turns the
+ * display off after a longer while.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#ifndef _UI_AMBIENT_H
+#define _UI_AMBIENT_H
+
+#include <stdbool.h>
+#include "lvgl.h"
+#include "display/display.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Start following the inactivity of the UI. */
+void ui_ambient_init();
+
+/* Switch the panel mode, the frames are reduced to the 8 colors before the idle mode starts. */
+int ui_display_mode_set(display_mode_t mode);
+
+/* Reduce RGB565 pixels to the 8 colors of the idle mode, in place. */
+void ui_quantize_8_colors(uint16_t *pixels, uint32_t count);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
@@ -0,0 +1,343 @@
+/** UI Automation implementation for LVGL-based UI.
+ * The script is parsed into steps when it is started. An LVGL timer walks through the steps and
+ * sets the state that the read callback of the virtual pointer returns to LVGL. The display
+ * events are used to measure, per step, the latency from the input to the next rendered frame,
+ * and during the whole script the frame time and the dropped frames.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#include "lvgl.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/shell/shell.h>
+
+#include "benchmark/benchmark.h"
+#include "userinterface/automation.h"
+
+LOG_MODULE_REGISTER(ZephyrWatch_UI_Automation, CONFIG_ZW_LOG_LEVEL);
+
+#define AUTOMATION_MAX_STEPS 32
+#define AUTOMATION_MAX_SCRIPT_LENGTH 256
+#define AUTOMATION_TIMER_PERIOD_MS 5
+// Longer gaps between two frames mean there was nothing to draw, not dropped frames.
+#define AUTOMATION_IDLE_GAP_MS 200
+
+typedef enum {
+    STEP_PRESS,
+    STEP_MOVE,
+    STEP_RELEASE,
+    STEP_WAIT,
+} automation_step_type_t;
+
+static const char *const step_names[] = { "press", "move", "release", "wait" };
+
+typedef struct {
+    automation_step_type_t type;
+    int16_t x;
+    int16_t y;
+    uint16_t duration_ms;
+} automation_step_t;
+
+// Scripts which can be run by name. They start on the home screen.
+typedef struct {
+    const char *name;
+    const char *script;
+} automation_script_t;
+
+static const automation_script_t builtin_scripts[] = {
+    { "swipe_menu", "press 120 200; move 120 40 150; release; wait 600" },
+    { "scroll_menu", "press 120 190; move 120 70 400; release; wait 600" },
+    { "double_tap_back", "press 120 30; wait 40; release; wait 60; press 120 30; wait 40; release; wait 600" },
+};
+
+// Per-step and per-script numbers.
+static BENCHMARK_METRIC_DEFINE(step_latency, "Automation input to frame", "us");
+static BENCHMARK_METRIC_DEFINE(frame_time, "Automation frame time", "us");
+static BENCHMARK_METRIC_DEFINE(dropped_frames, "Automation dropped frames", "frames");
+
+// Script handed over from other threads, picked up by the runner.
+static bool script_pending;
+static bool script_running;
+static struct k_spinlock pending_lock;
+
+// State of the running script, only touched from the LVGL task handler.
+static automation_step_t steps[AUTOMATION_MAX_STEPS];
+static uint8_t step_count;
+static uint8_t step_index;
+static uint32_t step_start_tick;
+static int16_t start_x, start_y;
+static bool step_started;
+static uint32_t script_dropped_frames;
+
+// State of the virtual pointer.
+static lv_point_t pointer_point;
+static lv_indev_state_t pointer_state = LV_INDEV_STATE_RELEASED;
+
+// Frame measurements.
+static uint32_t input_cycles;
+static bool waiting_for_frame;
+static uint32_t render_start_cycles;
+static uint32_t last_frame_tick;
+
+/* AUTOMATION_PARSE
+ * Parse the script into a step table. Returns the number of steps or a negative error.
+ */
+static int automation_parse(const char *script, automation_step_t *table) {
+    int count = 0;
+    const char *cursor = script;
+
+    while (*cursor != '\0') {
+        // Skip the separators and the leading spaces.
+        while (*cursor == ';' || isspace((unsigned char)*cursor)) cursor++;
+        if (*cursor == '\0') break;
+        if (*cursor == '#') {
+            while (*cursor != '\0' && *cursor != '\n') cursor++;
+            continue;
+        }
+        if (count >= AUTOMATION_MAX_STEPS) return -EINVAL;
+
+        automation_step_t *step = &table[count];
+        int type;
+        for (type = 0; type < (int)ARRAY_SIZE(step_names); type++) {
+            size_t length = strlen(step_names[type]);
+            if (strncmp(cursor, step_names[type], length) == 0 && !isalpha((unsigned char)cursor[length])) {
+                cursor += length;
+                break;
+            }
+        }
+        if (type == (int)ARRAY_SIZE(step_names)) return -EINVAL;
+        step->type = type;
+
+        // The arguments are numbers up to the end of the step.
+        long args[3] = {0};
+        int arg_count = 0;
+        char *end;
+        while (*cursor != '\0' && *cursor != ';' && *cursor != '\n') {
+            if (isspace((unsigned char)*cursor)) {
+                cursor++;
+                continue;
+            }
+            if (arg_count == (int)ARRAY_SIZE(args)) return -EINVAL;
+            args[arg_count++] = strtol(cursor, &end, 10);
+            if (end == cursor) return -EINVAL;
+            cursor = end;
+        }
+
+        static const int expected_args[] = { 2, 3, 0, 1 };
+        if (arg_count != expected_args[type]) return -EINVAL;
+        step->x = type == STEP_WAIT ? 0 : (int16_t)args[0];
+        step->y = (int16_t)args[1];
+        step->duration_ms = (uint16_t)(type == STEP_MOVE ? args[2] : type == STEP_WAIT ? args[0] : 0);
+        count++;
+    }
+    return count;
+}
+
+/* AUTOMATION_READ
+ * Read callback of the virtual pointer.
+ */
+static void automation_read(lv_indev_t *indev, lv_indev_data_t *data) {
+    data->point = pointer_point;
+    data->state = pointer_state;
+}
+
+/* AUTOMATION_DISPLAY_EVENT
+ * Measure the frames while a script runs.
+ */
+static void automation_display_event(lv_event_t *event) {
+    if (!script_running) return;
+    uint32_t now = k_cycle_get_32();
+
+    if (lv_event_get_code(event) == LV_EVENT_RENDER_START) {
+        render_start_cycles = now;
+        return;
+    }
+
+    benchmark_metric_record(&frame_time, k_cyc_to_us_floor32(now - render_start_cycles));
+    if (waiting_for_frame) {
+        waiting_for_frame = false;
+        uint32_t latency_us = k_cyc_to_us_floor32(now - input_cycles);
+        benchmark_metric_record(&step_latency, latency_us);
+        LOG_INF("Step %u (%s): %u us to the next frame.", step_index, step_names[steps[step_index].type], latency_us);
+    }
+
+    // Frames later than the refresh period are counted as dropped.
+    uint32_t tick = lv_tick_get();
+    uint32_t gap = tick - last_frame_tick;
+    if (last_frame_tick != 0 && gap > LV_DEF_REFR_PERIOD && gap < AUTOMATION_IDLE_GAP_MS) {
+        script_dropped_frames += gap / LV_DEF_REFR_PERIOD - 1;
+    }
+    last_frame_tick = tick;
+}
+
+/* AUTOMATION_START_STEP
+ * Apply the input of the step and start the latency measurement.
+ */
+static void automation_start_step(automation_step_t *step) {
+    step_start_tick = lv_tick_get();
+    start_x = pointer_point.x;
+    start_y = pointer_point.y;
+    step_started = true;
+
+    switch (step->type) {
+    case STEP_PRESS:
+        pointer_point.x = step->x;
+        pointer_point.y = step->y;
+        pointer_state = LV_INDEV_STATE_PRESSED;
+        break;
+    case STEP_RELEASE:
+        pointer_state = LV_INDEV_STATE_RELEASED;
+        break;
+    case STEP_MOVE:
+    case STEP_WAIT:
+        break;
+    }
+
+    if (step->type != STEP_WAIT) {
+        input_cycles = k_cycle_get_32();
+        waiting_for_frame = true;
+    }
+}
+
+/* AUTOMATION_RUNNER
+ * Advance the running script, or start the pending one.
+ */
+static void automation_runner(lv_timer_t *timer) {
+    if (!script_running) {
+        k_spinlock_key_t key = k_spin_lock(&pending_lock);
+        if (script_pending) {
+            script_pending = false;
+            script_running = true;
+            step_index = 0;
+            step_started = false;
+            script_dropped_frames = 0;
+            last_frame_tick = 0;
+        }
+        k_spin_unlock(&pending_lock, key);
+        return;
+    }
+
+    if (step_index >= step_count) {
+        pointer_state = LV_INDEV_STATE_RELEASED;
+        waiting_for_frame = false;
+        benchmark_metric_record(&dropped_frames, script_dropped_frames);
+        LOG_INF("Script is done, %u frames dropped.", script_dropped_frames);
+        benchmark_report_all();
+        script_running = false;
+        return;
+    }
+
+    automation_step_t *step = &steps[step_index];
+    if (!step_started) {
+        automation_start_step(step);
+    }
+
+    uint32_t elapsed = lv_tick_elaps(step_start_tick);
+    if (step->type == STEP_MOVE && step->duration_ms) {
+        uint32_t progress = MIN(elapsed, step->duration_ms);
+        pointer_point.x = start_x + (step->x - start_x) * (int32_t)progress / step->duration_ms;
+        pointer_point.y = start_y + (step->y - start_y) * (int32_t)progress / step->duration_ms;
+    }
+    // A press or a release ends with its frame, the next step would otherwise be applied in the
+    // same frame. An input with nothing to draw has no frame of its own and no latency.
+    bool frame_pending = step->duration_ms == 0 && waiting_for_frame && elapsed < AUTOMATION_IDLE_GAP_MS;
+    if (elapsed >= step->duration_ms && !frame_pending) {
+        waiting_for_frame = false;
+        step_index++;
+        step_started = false;
+    }
+}
+
+/* UI_AUTOMATION_RUN
+ * Parse the script and hand it over to the runner.
+ */
+int ui_automation_run(const char *script) {
+    for (int i = 0; i < ARRAY_SIZE(builtin_scripts); i++) {
+        if (strcmp(script, builtin_scripts[i].name) == 0) {
+            script = builtin_scripts[i].script;
+            break;
+        }
+    }
+
+    automation_step_t parsed[AUTOMATION_MAX_STEPS];
+    int count = automation_parse(script, parsed);
+    if (count <= 0) {
+        LOG_ERR("Cannot parse the script: %s", script);
+        return -EINVAL;
+    }
+
+    // The step table belongs to the runner while a script is pending or running.
+    k_spinlock_key_t key = k_spin_lock(&pending_lock);
+    if (script_pending || script_running) {
+        k_spin_unlock(&pending_lock, key);
+        return -EBUSY;
+    }
+    memcpy(steps, parsed, count * sizeof(automation_step_t));
+    step_count = count;
+    script_pending = true;
+    k_spin_unlock(&pending_lock, key);
+
+    LOG_INF("Script with %d steps is queued.", count);
+    return 0;
+}
+
+/* UI_AUTOMATION_INIT
+ * Create the virtual pointer and the runner timer.
+ */
+void ui_automation_init(lv_display_t *display) {
+    lv_indev_t *indev = lv_indev_create();
+    lv_indev_set_type(indev, LV_INDEV_TYPE_POINTER);
+    lv_indev_set_read_cb(indev, automation_read);
+    lv_indev_set_display(indev, display);
+
+    lv_display_add_event_cb(display, automation_display_event, LV_EVENT_RENDER_START, NULL);
+    lv_display_add_event_cb(display, automation_display_event, LV_EVENT_RENDER_READY, NULL);
+    lv_timer_create(automation_runner, AUTOMATION_TIMER_PERIOD_MS, NULL);
+
+    if (strlen(CONFIG_ZW_UI_AUTOMATION_BOOT_SCRIPT) > 0) {
+        ui_automation_run(CONFIG_ZW_UI_AUTOMATION_BOOT_SCRIPT);
+    }
+    LOG_DBG("UI automation is ready.");
+}
+
+#if defined(CONFIG_SHELL)
+/* CMD_UI_AUTOMATION_RUN
+ * "ui_automation run <name|script>" in the shell. The script is the rest of the line.
+ */
+static int cmd_ui_automation_run(const struct shell *sh, size_t argc, char **argv) {
+    static char script[AUTOMATION_MAX_SCRIPT_LENGTH];
+    script[0] = '\0';
+    for (size_t i = 1; i < argc; i++) {
+        if (i > 1) strncat(script, " ", sizeof(script) - strlen(script) - 1);
+        strncat(script, argv[i], sizeof(script) - strlen(script) - 1);
+    }
+
+    int ret = ui_automation_run(script);
+    if (ret) {
+        shell_error(sh, "Script is not started (%d).", ret);
+    }
+    return ret;
+}
+
+/* CMD_UI_AUTOMATION_LIST
+ * "ui_automation list" prints the built-in scripts.
+ */
+static int cmd_ui_automation_list(const struct shell *sh, size_t argc, char **argv) {
+    for (int i = 0; i < ARRAY_SIZE(builtin_scripts); i++) {
+        shell_print(sh, "%s: %s", builtin_scripts[i].name, builtin_scripts[i].script);
+    }
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(ui_automation_cmds,
+    SHELL_CMD_ARG(run, NULL, "Run a built-in script or a script with ';' separated steps.", cmd_ui_automation_run, 2, SHELL_OPT_ARG_RAW),
+    SHELL_CMD(list, NULL, "List the built-in scripts.", cmd_ui_automation_list),
+    SHELL_SUBCMD_SET_END
+);
+SHELL_CMD_REGISTER(ui_automation, &ui_automation_cmds, "Replay touch sequences.", NULL);
+#endif
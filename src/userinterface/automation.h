@@ -0,0 +1,37 @@
+/** UI Automation interface for LVGL-based UI.
+ * Replays timed touch sequences into a virtual LVGL pointer, so the gestures are benchmarked the
+ * same way every time. A script has one step per line (or separated with ';'):
+ *
+ *   press X Y        touch the screen at X, Y
+ *   move X Y MS      slide to X, Y in MS milliseconds while touching
+ *   release          lift the finger
+ *   wait MS          do nothing for MS milliseconds
+ *   # comment
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#ifndef _UI_AUTOMATION_H
+#define _UI_AUTOMATION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "lvgl.h"
+
+/* Create the virtual input device on the display and start the script runner. */
+void ui_automation_init(lv_display_t *display);
+
+/* Run the built-in script with the given name, or the text itself as a script if there is no
+ * such script. It can be called from any thread, the script runs in the LVGL task handler.
+ * Returns 0, -EBUSY if a script is already running or -EINVAL if the script cannot be parsed.
+ */
+int ui_automation_run(const char *script);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
@@ -0,0 +1,146 @@
+/** Screen Construction Scheduler implementation for LVGL-based UI.
+ * The scheduler timer runs once per refresh period. It takes steps of the first queued
+ * construction until the budget of the frame is spent, at least one, and leaves the rest of the
+ * frame to the rendering. The constructions are done one after the other, in the order of their
+ * requests. A cancelled construction keeps the steps done so far, only its done callback is not
+ * called.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#include <errno.h>
+
+#include "lvgl.h"
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/spinlock.h>
+
+#include "benchmark/benchmark.h"
+#include "userinterface/construct.h"
+
+LOG_MODULE_REGISTER(ZephyrWatch_UI_Construct, CONFIG_ZW_LOG_LEVEL);
+
+#define CONSTRUCT_QUEUE_SIZE 4
+
+typedef struct {
+    ui_construct_step_t step;
+    ui_construct_done_t done;
+#if defined(CONFIG_ZW_RENDER_STATS)
+    int64_t requested_ms;
+#endif
+} construct_job_t;
+
+static construct_job_t queue[CONSTRUCT_QUEUE_SIZE];
+static uint8_t queue_length;
+static struct k_spinlock queue_lock;
+
+#if defined(CONFIG_ZW_RENDER_STATS)
+// The time between two scheduler runs is the frame time, with the steps taken in it. The
+// maximum is the worst frame during the constructions.
+static BENCHMARK_METRIC_DEFINE(construct_frame_time, "Frame time during construction", "us");
+static BENCHMARK_METRIC_DEFINE(construct_total_time, "Screen construction", "ms");
+static uint32_t last_run_cycles;
+static bool was_constructing;
+#endif
+
+/* UI_CONSTRUCT_REQUEST
+ * Add the construction to the end of the queue, unless it is there already.
+ */
+int ui_construct_request(ui_construct_step_t step, ui_construct_done_t done) {
+    int ret = -ENOMEM;
+    k_spinlock_key_t key = k_spin_lock(&queue_lock);
+    for (uint8_t i = 0; i < queue_length; i++) {
+        if (queue[i].step == step) {
+            queue[i].done = done;
+            k_spin_unlock(&queue_lock, key);
+            return 0;
+        }
+    }
+    if (queue_length < CONSTRUCT_QUEUE_SIZE) {
+        queue[queue_length].step = step;
+        queue[queue_length].done = done;
+#if defined(CONFIG_ZW_RENDER_STATS)
+        queue[queue_length].requested_ms = k_uptime_get();
+#endif
+        queue_length++;
+        ret = 0;
+    }
+    k_spin_unlock(&queue_lock, key);
+    return ret;
+}
+
+/* UI_CONSTRUCT_CANCEL
+ * Remove the construction from the queue, also when it is the one in progress.
+ */
+void ui_construct_cancel(ui_construct_step_t step) {
+    k_spinlock_key_t key = k_spin_lock(&queue_lock);
+    for (uint8_t i = 0; i < queue_length; i++) {
+        if (queue[i].step == step) {
+            queue_length--;
+            for (; i < queue_length; i++) {
+                queue[i] = queue[i + 1];
+            }
+            break;
+        }
+    }
+    k_spin_unlock(&queue_lock, key);
+}
+
+/* CONSTRUCT_RUN
+ * Take the steps of the first construction within the budget of the frame.
+ */
+static void construct_run(lv_timer_t *timer) {
+    uint32_t start_cycles = k_cycle_get_32();
+#if defined(CONFIG_ZW_RENDER_STATS)
+    if (was_constructing) {
+        benchmark_metric_record(&construct_frame_time, k_cyc_to_us_floor32(start_cycles - last_run_cycles));
+    }
+    last_run_cycles = start_cycles;
+    was_constructing = false;
+#endif
+
+    k_spinlock_key_t key = k_spin_lock(&queue_lock);
+    if (queue_length == 0) {
+        k_spin_unlock(&queue_lock, key);
+        return;
+    }
+    construct_job_t job = queue[0];
+    k_spin_unlock(&queue_lock, key);
+
+    bool complete;
+    do {
+        complete = job.step();
+    } while (!complete && k_cyc_to_us_floor32(k_cycle_get_32() - start_cycles) < CONFIG_ZW_UI_CONSTRUCT_BUDGET_US);
+
+#if defined(CONFIG_ZW_RENDER_STATS)
+    was_constructing = true;
+#endif
+    if (!complete) return;
+
+    // The done callback may have been replaced meanwhile, it is taken with the job removed. A job
+    // cancelled meanwhile is not in the queue any more and is not done.
+    key = k_spin_lock(&queue_lock);
+    if (queue_length == 0 || queue[0].step != job.step) {
+        k_spin_unlock(&queue_lock, key);
+        return;
+    }
+    job.done = queue[0].done;
+    queue_length--;
+    for (uint8_t i = 0; i < queue_length; i++) {
+        queue[i] = queue[i + 1];
+    }
+    k_spin_unlock(&queue_lock, key);
+
+#if defined(CONFIG_ZW_RENDER_STATS)
+    benchmark_metric_record(&construct_total_time, (uint32_t)(k_uptime_get() - job.requested_ms));
+#endif
+    if (job.done != NULL) job.done();
+}
+
+/* UI_CONSTRUCT_INIT
+ * Run the scheduler once per refresh period.
+ */
+void ui_construct_init() {
+    lv_timer_create(construct_run, LV_DEF_REFR_PERIOD, NULL);
+}
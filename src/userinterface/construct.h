@@ -0,0 +1,42 @@
+/** Screen Construction Scheduler interface for LVGL-based UI.
+ * Runs the construction of the screens in steps from the LVGL task handler, with a time budget
+ * per frame, so the UI keeps rendering while a screen is built.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#ifndef _UI_CONSTRUCT_H
+#define _UI_CONSTRUCT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+/* A construction step. Returns true once the screen is complete, also when it already was. */
+typedef bool (*ui_construct_step_t)();
+
+/* Called from the LVGL task handler once the screen is complete. */
+typedef void (*ui_construct_done_t)();
+
+/* Start the scheduler timer. */
+void ui_construct_init();
+
+/* Queue the construction. It can be called from any thread. A construction with the same step
+ * which is already queued is kept, with the new done callback. Returns 0, or -ENOMEM if the queue
+ * is full.
+ */
+int ui_construct_request(ui_construct_step_t step, ui_construct_done_t done);
+
+/* Remove the queued construction of the step, its done callback is not called. It can be called
+ * from any thread.
+ */
+void ui_construct_cancel(ui_construct_step_t step);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
@@ -0,0 +1,245 @@
+/** LVGL Memory Pools implementation.
+ * The allocator of LVGL is wrapped at link time (-Wl,--wrap of lv_malloc_core, lv_realloc_core
+ * and lv_free_core). A request goes to the smallest size class it fits in, or to the next
+ * larger one when that is full, and to the LVGL heap when it is bigger than every class or all
+ * of them are full. A block is found to belong to a slab by its address on free.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#include <string.h>
+
+#include "lvgl.h"
+#include <lvgl_mem.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+#include "benchmark/benchmark.h"
+#include "userinterface/mempools.h"
+
+LOG_MODULE_REGISTER(ZephyrWatch_UI_MemPools, CONFIG_ZW_LOG_LEVEL);
+
+// The memory of the slabs is shared in percents between the classes, sized after the LVGL
+// structures of a 32-bit build: style entries, object attributes, objects, labels.
+#define MEMPOOLS_SIZE CONFIG_ZW_LVGL_MEM_POOLS_SIZE
+#define MEMPOOLS_BLOCKS(_block_size, _percent) \
+    MAX(MEMPOOLS_SIZE * (_percent) / 100 / (_block_size), 1)
+#define MEMPOOLS_ALIGN 8
+
+K_MEM_SLAB_DEFINE_STATIC(mempool_16, 16, MEMPOOLS_BLOCKS(16, 10), MEMPOOLS_ALIGN);
+K_MEM_SLAB_DEFINE_STATIC(mempool_32, 32, MEMPOOLS_BLOCKS(32, 20), MEMPOOLS_ALIGN);
+K_MEM_SLAB_DEFINE_STATIC(mempool_64, 64, MEMPOOLS_BLOCKS(64, 30), MEMPOOLS_ALIGN);
+K_MEM_SLAB_DEFINE_STATIC(mempool_128, 128, MEMPOOLS_BLOCKS(128, 30), MEMPOOLS_ALIGN);
+K_MEM_SLAB_DEFINE_STATIC(mempool_256, 256, MEMPOOLS_BLOCKS(256, 10), MEMPOOLS_ALIGN);
+
+typedef struct {
+    struct k_mem_slab *slab;
+    size_t block_size;
+    atomic_t misses; // Requests of this class that found it full.
+} mempool_class_t;
+
+static mempool_class_t classes[] = {
+    { &mempool_16, 16 },
+    { &mempool_32, 32 },
+    { &mempool_64, 64 },
+    { &mempool_128, 128 },
+    { &mempool_256, 256 },
+};
+
+static atomic_t heap_allocations;
+static atomic_t last_fragmentation;
+// Peak of the heap usage by LVGL. The max of the heap statistics also counts the probes of the
+// fragmentation sampling, which take the whole free heap.
+static atomic_t heap_peak_bytes;
+
+// How often the fragmentation of the heap is sampled.
+#define MEMPOOLS_SAMPLE_PERIOD_MS 60000
+
+#if defined(CONFIG_ZW_BENCHMARK)
+static BENCHMARK_METRIC_DEFINE(slab_alloc_time, "LVGL alloc from a slab", "ns");
+static BENCHMARK_METRIC_DEFINE(heap_alloc_time, "LVGL alloc from the heap", "ns");
+static BENCHMARK_METRIC_DEFINE(free_time, "LVGL free", "ns");
+static BENCHMARK_METRIC_DEFINE(heap_fragmentation, "LVGL heap fragmentation", "%");
+#endif
+
+// The original allocator of LVGL, the LVGL heap of Zephyr.
+void *__real_lv_malloc_core(size_t size);
+void *__real_lv_realloc_core(void *pointer, size_t size);
+void __real_lv_free_core(void *pointer);
+
+/* FIND_CLASS
+ * Size class of a block, or NULL if it comes from the heap.
+ */
+static mempool_class_t *find_class(const void *pointer) {
+    for (int i = 0; i < ARRAY_SIZE(classes); i++) {
+        const struct k_mem_slab *slab = classes[i].slab;
+        const char *start = slab->buffer;
+        if ((const char *)pointer >= start &&
+            (const char *)pointer < start + slab->info.num_blocks * slab->info.block_size) {
+            return &classes[i];
+        }
+    }
+    return NULL;
+}
+
+/* POOLS_ALLOC
+ * Take a block of the smallest class the size fits in, or of a larger one.
+ */
+static void *pools_alloc(size_t size) {
+    void *block;
+    for (int i = 0; i < ARRAY_SIZE(classes); i++) {
+        if (size > classes[i].block_size) continue;
+        if (k_mem_slab_alloc(classes[i].slab, &block, K_NO_WAIT) == 0) {
+            return block;
+        }
+        atomic_inc(&classes[i].misses);
+    }
+    return NULL;
+}
+
+/* NOTE_HEAP_USAGE
+ * Raise the peak of the heap usage after an allocation of LVGL.
+ */
+static void note_heap_usage() {
+    struct sys_memory_stats stats;
+    lvgl_heap_stats(&stats);
+    atomic_val_t peak = atomic_get(&heap_peak_bytes);
+    while ((atomic_val_t)stats.allocated_bytes > peak && !atomic_cas(&heap_peak_bytes, peak, stats.allocated_bytes)) {
+        peak = atomic_get(&heap_peak_bytes);
+    }
+}
+
+/* HEAP_ALLOC
+ * Fall back to the LVGL heap.
+ */
+static void *heap_alloc(size_t size) {
+    void *pointer = __real_lv_malloc_core(size);
+    if (pointer != NULL) {
+        atomic_inc(&heap_allocations);
+        note_heap_usage();
+    }
+    return pointer;
+}
+
+void *__wrap_lv_malloc_core(size_t size) {
+#if defined(CONFIG_ZW_BENCHMARK)
+    uint32_t start = k_cycle_get_32();
+#endif
+    void *pointer = pools_alloc(size);
+#if defined(CONFIG_ZW_BENCHMARK)
+    if (pointer != NULL) {
+        benchmark_metric_record(&slab_alloc_time, k_cyc_to_ns_floor32(k_cycle_get_32() - start));
+        return pointer;
+    }
+    pointer = heap_alloc(size);
+    benchmark_metric_record(&heap_alloc_time, k_cyc_to_ns_floor32(k_cycle_get_32() - start));
+    return pointer;
+#else
+    return pointer != NULL ? pointer : heap_alloc(size);
+#endif
+}
+
+void __wrap_lv_free_core(void *pointer) {
+    if (pointer == NULL) return;
+#if defined(CONFIG_ZW_BENCHMARK)
+    uint32_t start = k_cycle_get_32();
+#endif
+    mempool_class_t *class = find_class(pointer);
+    if (class != NULL) {
+        k_mem_slab_free(class->slab, pointer);
+    } else {
+        __real_lv_free_core(pointer);
+        atomic_dec(&heap_allocations);
+    }
+#if defined(CONFIG_ZW_BENCHMARK)
+    benchmark_metric_record(&free_time, k_cyc_to_ns_floor32(k_cycle_get_32() - start));
+#endif
+}
+
+/* __WRAP_LV_REALLOC_CORE
+ * A block stays where it is while the new size still fits. A slab block that outgrows its class
+ * moves, a heap block stays on the heap.
+ */
+void *__wrap_lv_realloc_core(void *pointer, size_t size) {
+    if (pointer == NULL) return __wrap_lv_malloc_core(size);
+
+    mempool_class_t *class = find_class(pointer);
+    if (class == NULL) {
+        void *resized = __real_lv_realloc_core(pointer, size);
+        if (resized != NULL) note_heap_usage();
+        return resized;
+    }
+    if (size <= class->block_size) {
+        return pointer;
+    }
+
+    void *moved = __wrap_lv_malloc_core(size);
+    if (moved != NULL) {
+        memcpy(moved, pointer, class->block_size);
+        k_mem_slab_free(class->slab, pointer);
+    }
+    return moved;
+}
+
+/* LARGEST_HEAP_BLOCK
+ * Largest block the heap can give at once, found by halving the step of the tried size.
+ */
+static size_t largest_heap_block(size_t free_bytes) {
+    size_t largest = 0;
+    size_t step = MEMPOOLS_ALIGN;
+    while (step < free_bytes) step *= 2;
+    for (; step >= MEMPOOLS_ALIGN; step /= 2) {
+        void *probe = __real_lv_malloc_core(largest + step);
+        if (probe != NULL) {
+            __real_lv_free_core(probe);
+            largest += step;
+        }
+    }
+    return largest;
+}
+
+/* MEMPOOLS_SAMPLE
+ * The part of the free heap which can't be allocated in one block. The probing runs on the UI
+ * thread, so no LVGL allocation finds the heap taken by a probe.
+ */
+static void mempools_sample(lv_timer_t *timer) {
+    struct sys_memory_stats stats;
+    lvgl_heap_stats(&stats);
+    if (stats.free_bytes == 0) return;
+
+    size_t largest = MIN(largest_heap_block(stats.free_bytes), stats.free_bytes);
+    uint32_t fragmentation = 100 - largest * 100 / stats.free_bytes;
+    atomic_set(&last_fragmentation, fragmentation);
+#if defined(CONFIG_ZW_BENCHMARK)
+    benchmark_metric_record(&heap_fragmentation, fragmentation);
+#endif
+}
+
+/* UI_MEM_POOLS_INIT
+ * Start sampling the fragmentation of the heap.
+ */
+void ui_mem_pools_init() {
+    lv_timer_create(mempools_sample, MEMPOOLS_SAMPLE_PERIOD_MS, NULL);
+}
+
+/* UI_MEM_POOLS_REPORT
+ * Print the blocks in use per class and the state of the heap, with the peak usage by LVGL and
+ * the last sampled fragmentation.
+ */
+void ui_mem_pools_report() {
+    for (int i = 0; i < ARRAY_SIZE(classes); i++) {
+        struct k_mem_slab *slab = classes[i].slab;
+        LOG_INF("LVGL %zu byte blocks: %u of %u used (max %u), %u full misses.", classes[i].block_size,
+                k_mem_slab_num_used_get(slab), slab->info.num_blocks, k_mem_slab_max_used_get(slab),
+                (uint32_t)atomic_get(&classes[i].misses));
+    }
+
+    struct sys_memory_stats stats;
+    lvgl_heap_stats(&stats);
+    LOG_INF("LVGL heap: %u allocations, %zu bytes used (max %zu), %zu free, %u%% fragmented.",
+            (uint32_t)atomic_get(&heap_allocations), stats.allocated_bytes, (size_t)atomic_get(&heap_peak_bytes), stats.free_bytes,
+            (uint32_t)atomic_get(&last_fragmentation));
+}
@@ -0,0 +1,29 @@
+/** LVGL Memory Pools interface.
+ * Serves the small LVGL allocations (objects, labels, style entries) from fixed size-class slabs,
+ * the rest from the LVGL heap. Screens being created and deleted and label texts being
+ * reallocated then do not cut the heap into small free chunks over a long uptime.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#ifndef _UI_MEMPOOLS_H
+#define _UI_MEMPOOLS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Start sampling the fragmentation of the LVGL heap: the part of the free heap in percent that
+ * can't be allocated in one block.
+ */
+void ui_mem_pools_init();
+
+/* Print the usage of every size class and the heap to the logger. Safe from any thread. */
+void ui_mem_pools_report();
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
@@ -0,0 +1,43 @@
+/** Screen Preloading implementation for LVGL-based UI.
+ * The menu is the screen opened from the home screen. Its construction is only requested when
+ * nothing was touched for a while and no animation is running, so the preloading never competes
+ * with a gesture or a transition. The construction scheduler then builds it within the frame
+ * budget.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#include "lvgl.h"
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "userinterface/construct.h"
+#include "userinterface/preload.h"
+#include "userinterface/screens/home/home.h"
+#include "userinterface/screens/menu/menu.h"
+
+LOG_MODULE_REGISTER(ZephyrWatch_UI_Preload, CONFIG_ZW_LOG_LEVEL);
+
+// How often the idle state is checked.
+#define PRELOAD_PERIOD_MS 100
+
+/* PRELOAD_STEP
+ * Request the construction of the menu if the home screen is shown and the UI is idle.
+ */
+static void preload_step(lv_timer_t *timer) {
+    if (lv_display_get_inactive_time(NULL) < CONFIG_ZW_UI_PRELOAD_IDLE_MS || lv_anim_count_running()) {
+        return;
+    }
+
+    if (lv_screen_active() == home_screen && !menu_screen_is_built()) {
+        ui_construct_request(menu_screen_build_step, NULL);
+    }
+}
+
+/* UI_PRELOAD_INIT
+ * Start the preload timer.
+ */
+void ui_preload_init() {
+    lv_timer_create(preload_step, PRELOAD_PERIOD_MS, NULL);
+}
@@ -0,0 +1,23 @@
+/** Screen Preloading interface for LVGL-based UI.
+ * Builds the screen the user is likely to open next while the UI is idle, so the gesture that
+ * opens it does not wait for its objects to be created.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#ifndef _UI_PRELOAD_H
+#define _UI_PRELOAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Start the idle time construction. */
+void ui_preload_init();
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
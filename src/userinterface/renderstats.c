@@ -0,0 +1,130 @@
+/** Render Statistics implementation for LVGL-based UI.
+ * Hooks into LVGL's display events to measure the time spent rendering (drawing into the draw
+ * buffers) and flushing (sending the draw buffers to the GC9A01 over SPI) for each frame. The
+ * numbers are reported together with the memory placement the firmware was built with.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#include "lvgl.h"
+#include <stdio.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "benchmark/benchmark.h"
+#include "userinterface/renderstats.h"
+
+LOG_MODULE_REGISTER(ZephyrWatch_UI_RenderStats, CONFIG_ZW_LOG_LEVEL);
+
+#if defined(CONFIG_ZW_LVGL_HEAP_PSRAM)
+#define LVGL_HEAP_PLACEMENT "PSRAM"
+#else
+#define LVGL_HEAP_PLACEMENT "internal SRAM"
+#endif
+
+// Per-frame metrics in microseconds and pixels per millisecond.
+static BENCHMARK_METRIC_DEFINE(render_time, "Render time", "us");
+static BENCHMARK_METRIC_DEFINE(flush_time, "Flush time", "us");
+static BENCHMARK_METRIC_DEFINE(render_throughput, "Render throughput", "px/ms");
+static BENCHMARK_METRIC_DEFINE(flush_throughput, "Flush throughput", "px/ms");
+
+// Per-screen render time and redrawn area (the flushed pixels of a frame).
+#define RENDER_STATS_MAX_SCREENS 8
+#define RENDER_STATS_NAME_LENGTH 32
+typedef struct {
+    lv_obj_t **screen;
+    char render_time_name[RENDER_STATS_NAME_LENGTH];
+    char redrawn_area_name[RENDER_STATS_NAME_LENGTH];
+    benchmark_metric_t render_time;
+    benchmark_metric_t redrawn_area;
+} screen_stats_t;
+static screen_stats_t screen_stats[RENDER_STATS_MAX_SCREENS];
+static uint8_t screen_stats_count;
+
+// State of the frame being rendered.
+static uint32_t frame_start_cycles;
+static uint32_t flush_start_cycles;
+static uint32_t frame_flush_cycles;
+static uint32_t frame_pixels;
+
+/* RENDER_STATS_EVENT
+ * Display event handler. LVGL sends RENDER_START and RENDER_READY around a frame and
+ * FLUSH_START and FLUSH_FINISH around every flushed area within that frame.
+ */
+static void render_stats_event(lv_event_t *event) {
+    lv_event_code_t code = lv_event_get_code(event);
+    uint32_t now = k_cycle_get_32();
+
+    switch (code) {
+    case LV_EVENT_RENDER_START:
+        frame_start_cycles = now;
+        frame_flush_cycles = 0;
+        frame_pixels = 0;
+        break;
+    case LV_EVENT_FLUSH_START:
+        flush_start_cycles = now;
+        break;
+    case LV_EVENT_FLUSH_FINISH: {
+        const lv_area_t *area = lv_event_get_param(event);
+        frame_flush_cycles += now - flush_start_cycles;
+        if (area != NULL) frame_pixels += lv_area_get_size(area);
+        break;
+    }
+    case LV_EVENT_RENDER_READY: {
+        // The frame time contains the flushes, subtract them to get the pure render time.
+        uint32_t flush_us = k_cyc_to_us_floor32(frame_flush_cycles);
+        uint32_t render_us = k_cyc_to_us_floor32(now - frame_start_cycles) - flush_us;
+        if (frame_pixels == 0) break;
+
+        benchmark_metric_record(&render_time, render_us);
+        benchmark_metric_record(&flush_time, flush_us);
+        if (render_us) benchmark_metric_record(&render_throughput, frame_pixels * 1000U / render_us);
+        if (flush_us) benchmark_metric_record(&flush_throughput, frame_pixels * 1000U / flush_us);
+
+        // Account the frame to the active screen as well, if it is tracked.
+        lv_obj_t *active = lv_display_get_screen_active(lv_event_get_target(event));
+        for (uint8_t i = 0; i < screen_stats_count; i++) {
+            if (*screen_stats[i].screen == active) {
+                benchmark_metric_record(&screen_stats[i].render_time, render_us);
+                benchmark_metric_record(&screen_stats[i].redrawn_area, frame_pixels);
+                break;
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/* RENDER_STATS_INIT
+ * Register the display event handlers. The metrics are printed by the benchmark subsystem.
+ */
+void render_stats_init(lv_display_t *display) {
+    lv_display_add_event_cb(display, render_stats_event, LV_EVENT_RENDER_START, NULL);
+    lv_display_add_event_cb(display, render_stats_event, LV_EVENT_RENDER_READY, NULL);
+    lv_display_add_event_cb(display, render_stats_event, LV_EVENT_FLUSH_START, NULL);
+    lv_display_add_event_cb(display, render_stats_event, LV_EVENT_FLUSH_FINISH, NULL);
+
+    LOG_INF("Render statistics: LVGL heap in %s, draw buffers in internal SRAM.", LVGL_HEAP_PLACEMENT);
+}
+
+/* RENDER_STATS_TRACK_SCREEN
+ * Add a screen to the per-screen statistics.
+ */
+int render_stats_track_screen(lv_obj_t **screen, const char *name) {
+    if (screen_stats_count >= RENDER_STATS_MAX_SCREENS) {
+        LOG_ERR("Cannot track more than %d screens.", RENDER_STATS_MAX_SCREENS);
+        return -ENOMEM;
+    }
+
+    screen_stats_t *stats = &screen_stats[screen_stats_count];
+    snprintf(stats->render_time_name, sizeof(stats->render_time_name), "Render time (%s)", name);
+    snprintf(stats->redrawn_area_name, sizeof(stats->redrawn_area_name), "Redrawn area (%s)", name);
+    stats->screen = screen;
+    stats->render_time = (benchmark_metric_t){ .name = stats->render_time_name, .unit = "us", .min = UINT32_MAX };
+    stats->redrawn_area = (benchmark_metric_t){ .name = stats->redrawn_area_name, .unit = "px", .min = UINT32_MAX };
+    screen_stats_count++;
+    return 0;
+}
@@ -0,0 +1,30 @@
+/** Render Statistics interface for LVGL-based UI.
+ * Measures how long LVGL spends rendering into the draw buffers and flushing them to the panel,
+ * so different memory placements of the LVGL heap and the draw buffers can be compared.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#ifndef _UI_RENDERSTATS_H
+#define _UI_RENDERSTATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "lvgl.h"
+
+/* Attach the statistics collectors to the given display. */
+void render_stats_init(lv_display_t *display);
+
+/* Record the frames of the screen pointed by the variable separately. The variable is followed,
+ * so the screens can be deleted and created again. Returns 0, or -ENOMEM if the table is full.
+ */
+int render_stats_track_screen(lv_obj_t **screen, const char *name);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
@@ -0,0 +1,207 @@
+/** Screen Benchmark implementation for LVGL-based UI.
+ * An LVGL timer loads each screen, invalidates and redraws it a number of times, so the render
+ * statistics collect the render time and the redrawn area per screen. After the frames, a
+ * snapshot of the screen is taken and its CRC is printed as the layout checksum. On native_sim
+ * the clock starts at a fixed time, so the snapshot is also compared pixel by pixel with the
+ * golden image of the screen, and the program exits with an error when they differ.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#include "lvgl.h"
+#include <stdlib.h>
+#include <zephyr/kernel.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/sys/util.h>
+
+#include "benchmark/benchmark.h"
+#include "userinterface/screenbench.h"
+#include "userinterface/screens/home/home.h"
+#include "userinterface/screens/menu/menu.h"
+#include "userinterface/screens/blepairing/blepairing.h"
+
+#if defined(CONFIG_ZW_UI_SCREEN_BENCH_GOLDEN)
+#include <posix_board_if.h>
+#endif
+
+LOG_MODULE_REGISTER(ZephyrWatch_UI_ScreenBench, CONFIG_ZW_LOG_LEVEL);
+
+// Let the first clock and date updates land before the first screen.
+#define SCREEN_BENCH_START_DELAY_MS 3000
+
+// The golden PNGs in golden/ are converted to packed RGB565 and embedded by CMake when they exist.
+#if defined(SCREEN_BENCH_GOLDEN_HOME)
+static const uint8_t golden_home[] = {
+#include "golden_home.inc"
+};
+#define GOLDEN_HOME golden_home, sizeof(golden_home)
+#else
+#define GOLDEN_HOME NULL, 0
+#endif
+#if defined(SCREEN_BENCH_GOLDEN_MENU)
+static const uint8_t golden_menu[] = {
+#include "golden_menu.inc"
+};
+#define GOLDEN_MENU golden_menu, sizeof(golden_menu)
+#else
+#define GOLDEN_MENU NULL, 0
+#endif
+#if defined(SCREEN_BENCH_GOLDEN_BLEPAIRING)
+static const uint8_t golden_blepairing[] = {
+#include "golden_blepairing.inc"
+};
+#define GOLDEN_BLEPAIRING golden_blepairing, sizeof(golden_blepairing)
+#else
+#define GOLDEN_BLEPAIRING NULL, 0
+#endif
+
+// The screens to render, with their init functions to create them if needed.
+typedef struct {
+    const char *name;
+    lv_obj_t **screen;
+    void (*init)();
+    const uint8_t *golden;
+    size_t golden_size;
+} bench_screen_t;
+
+static const bench_screen_t bench_screens[] = {
+    { "home", &home_screen, home_screen_init, GOLDEN_HOME },
+#if defined(CONFIG_ZW_UI_MENU)
+    { "menu", &menu_screen, menu_screen_init, GOLDEN_MENU },
+#endif
+#if defined(CONFIG_ZW_UI_BLEPAIRING)
+    { "blepairing", &blepairing_screen, blepairing_screen_init, GOLDEN_BLEPAIRING },
+#endif
+};
+static uint8_t bench_index;
+static uint8_t bench_failures;
+
+#if defined(CONFIG_ZW_UI_SCREEN_BENCH_GOLDEN)
+/* SCREEN_BENCH_PRINT_GOLDEN
+ * Print the snapshot row by row in hex, scripts/screenbench_golden.py writes it to golden/.
+ */
+static void screen_bench_print_golden(const lv_draw_buf_t *snapshot, const char *name) {
+    static char hex[DT_PROP(DT_CHOSEN(zephyr_display), width) * sizeof(uint16_t) * 2 + 1];
+    uint32_t row_size = MIN(snapshot->header.w * sizeof(uint16_t), (sizeof(hex) - 1) / 2);
+
+    // The deferred logging would drop most of the rows, print them synchronously.
+    LOG_PANIC();
+    for (uint32_t y = 0; y < snapshot->header.h; y++) {
+        bin2hex(snapshot->data + y * snapshot->header.stride, row_size, hex, sizeof(hex));
+        printk("golden %s %u %s\n", name, y, hex);
+    }
+}
+
+/* SCREEN_BENCH_COMPARE
+ * Return the number of pixels which differ from the golden image by more than the tolerance in
+ * any color channel, -1 if the sizes do not match.
+ */
+static int screen_bench_compare(const lv_draw_buf_t *snapshot, const bench_screen_t *entry) {
+    uint32_t row_size = snapshot->header.w * sizeof(uint16_t);
+    if (entry->golden_size != row_size * snapshot->header.h) return -1;
+
+    int differing = 0;
+    for (uint32_t y = 0; y < snapshot->header.h; y++) {
+        const uint16_t *row = (const uint16_t *)(snapshot->data + y * snapshot->header.stride);
+        const uint8_t *golden_row = entry->golden + y * row_size;
+        for (uint32_t x = 0; x < snapshot->header.w; x++) {
+            uint16_t pixel = row[x];
+            uint16_t golden = sys_get_le16(golden_row + x * sizeof(uint16_t));
+            if (abs((pixel >> 11) - (golden >> 11)) > CONFIG_ZW_UI_SCREEN_BENCH_TOLERANCE ||
+                abs(((pixel >> 5) & 0x3F) - ((golden >> 5) & 0x3F)) > CONFIG_ZW_UI_SCREEN_BENCH_TOLERANCE ||
+                abs((pixel & 0x1F) - (golden & 0x1F)) > CONFIG_ZW_UI_SCREEN_BENCH_TOLERANCE) {
+                differing++;
+            }
+        }
+    }
+    return differing;
+}
+
+/* SCREEN_BENCH_CHECK_GOLDEN
+ * Compare the snapshot with the golden image, or print it as the new one. A screen without a
+ * golden image fails like a different one.
+ */
+static void screen_bench_check_golden(const lv_draw_buf_t *snapshot, const bench_screen_t *entry) {
+    if (IS_ENABLED(CONFIG_ZW_UI_SCREEN_BENCH_GOLDEN_UPDATE)) {
+        screen_bench_print_golden(snapshot, entry->name);
+        return;
+    }
+    if (entry->golden == NULL) {
+        LOG_ERR("Screen %s has no golden image.", entry->name);
+        bench_failures++;
+        return;
+    }
+    int differing = screen_bench_compare(snapshot, entry);
+    if (differing < 0) {
+        LOG_ERR("Screen %s: the golden image has a different size.", entry->name);
+        bench_failures++;
+    } else if (differing > CONFIG_ZW_UI_SCREEN_BENCH_MAX_PIXELS) {
+        LOG_ERR("Screen %s: %d pixels differ from the golden image.", entry->name, differing);
+        bench_failures++;
+    } else {
+        LOG_INF("Screen %s matches the golden image, %d pixels in the tolerance.", entry->name, differing);
+    }
+}
+#endif
+
+/* SCREEN_BENCH_CHECK
+ * Render the screen into an RGB565 snapshot, print its CRC and check it against the golden image.
+ */
+static void screen_bench_check(const bench_screen_t *entry) {
+    lv_draw_buf_t *snapshot = lv_snapshot_take(*entry->screen, LV_COLOR_FORMAT_RGB565);
+    if (snapshot == NULL) {
+        LOG_WRN("Not enough memory for the snapshot.");
+        bench_failures++;
+        return;
+    }
+    LOG_INF("Screen %s: layout checksum 0x%08x.", entry->name, crc32_ieee(snapshot->data, snapshot->data_size));
+#if defined(CONFIG_ZW_UI_SCREEN_BENCH_GOLDEN)
+    screen_bench_check_golden(snapshot, entry);
+#endif
+    lv_draw_buf_destroy(snapshot);
+}
+
+/* SCREEN_BENCH_STEP
+ * Render one screen per timer period, go back to the home screen after the last one.
+ */
+static void screen_bench_step(lv_timer_t *timer) {
+    if (bench_index >= ARRAY_SIZE(bench_screens)) {
+        lv_timer_delete(timer);
+        lv_screen_load(home_screen);
+        benchmark_report_all();
+        LOG_INF("Screen benchmark is done, %u screens failed.", bench_failures);
+#if defined(CONFIG_ZW_UI_SCREEN_BENCH_GOLDEN)
+        // The exit code tells if a screen differs from its golden image.
+        LOG_PANIC();
+        posix_exit(bench_failures ? 1 : 0);
+#endif
+        return;
+    }
+
+    const bench_screen_t *entry = &bench_screens[bench_index++];
+    if (!lv_obj_is_valid(*entry->screen)) {
+        entry->init();
+    }
+    lv_screen_load(*entry->screen);
+    for (int frame = 0; frame < CONFIG_ZW_UI_SCREEN_BENCH_FRAMES; frame++) {
+        lv_obj_invalidate(*entry->screen);
+        lv_refr_now(NULL);
+    }
+    screen_bench_check(entry);
+}
+
+/* SCREEN_BENCH_START
+ * Create the timer which walks through the screens.
+ */
+void screen_bench_start() {
+    lv_timer_t *timer = lv_timer_create(screen_bench_step, SCREEN_BENCH_START_DELAY_MS, NULL);
+    if (timer == NULL) {
+        LOG_ERR("Failed to create the screen benchmark timer.");
+        return;
+    }
+    LOG_INF("Screen benchmark of %u screens starts in %d ms.", ARRAY_SIZE(bench_screens), SCREEN_BENCH_START_DELAY_MS);
+}
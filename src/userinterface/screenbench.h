@@ -0,0 +1,24 @@
+/** Screen Benchmark interface for LVGL-based UI.
+ * Renders every screen of the watch a number of times and prints a checksum of each screen, so a
+ * change in the layout helpers or the styles shows up both in the render numbers and the checksums.
+ * On native_sim the screens are also compared with their golden images.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#ifndef _UI_SCREENBENCH_H
+#define _UI_SCREENBENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Start rendering the screens one by one, from the LVGL task handler. */
+void screen_bench_start();
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
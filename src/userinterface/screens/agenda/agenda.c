@@ -0,0 +1,176 @@
+/** Agenda Screen Implementation.
+ * The first row is found with a binary search of the current time in the calendar, stepping
+ * back over the events still going on, and only the events of the rows are read. The rows are
+ * filled again when the calendar changes or the minute does. A tap shows the next page, and a
+ * reminder brings the screen up with the event on the top.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "lvgl.h"
+
+#include "calendar/calendar.h"
+#include "datetime/datetime.h"
+#include "devicetwin/devicetwin.h"
+#include "userinterface/utils.h"
+#include "userinterface/screens/menu/menu.h"
+#include "userinterface/screens/agenda/agenda.h"
+#include "userinterface/screens/blepairing/blepairing.h"
+
+LOG_MODULE_REGISTER(ZephyrWatch_UI_Agenda, CONFIG_ZW_LOG_LEVEL);
+
+#define AGENDA_ROWS 4
+#define AGENDA_REFRESH_MS 1000
+
+/* Names of the Weekdays */
+static const char* weekdays[] = { "SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT" };
+
+// What the rows show: the calendar revision, the minute and the page.
+static uint32_t shown_revision;
+static uint32_t shown_minute = UINT32_MAX;
+static uint8_t page;
+static lv_timer_t *refresh_timer;
+
+// Holds the agenda screen objects.
+lv_obj_t *agenda_screen;
+static lv_obj_t *label_header;
+static lv_obj_t *label_when[AGENDA_ROWS];
+static lv_obj_t *label_title[AGENDA_ROWS];
+
+/* FIRST_ROW_INDEX
+ * Index of the first event of the page. The events started before now which have not ended yet
+ * are on the first page as well.
+ */
+static size_t first_row_index(uint32_t now) {
+    size_t index = calendar_find(now);
+    calendar_event_t event;
+    for (int i = 0; i < AGENDA_ROWS && index > 0; i++) {
+        if (calendar_get(index - 1, &event) || event.start + event.duration_min * 60 <= now) break;
+        index--;
+    }
+    return index + page * AGENDA_ROWS;
+}
+
+/* SHOW_ROWS
+ * Fill the rows with the events of the page.
+ */
+static void show_rows(uint32_t now) {
+    int8_t utc_zone = get_device_twin_instance()->utc_zone;
+    datetime_t today = unix_to_localtime(now, utc_zone);
+    size_t index = first_row_index(now);
+    calendar_event_t event;
+
+    for (int row = 0; row < AGENDA_ROWS; row++) {
+        if (calendar_get(index + row, &event)) {
+            lv_label_set_text(label_when[row], "");
+            lv_label_set_text(label_title[row], row == 0 ? "No events" : "");
+            continue;
+        }
+        datetime_t start = unix_to_localtime(event.start, utc_zone);
+        if (event.start <= now) {
+            lv_label_set_text(label_when[row], "NOW");
+        } else if (start.day == today.day && start.month == today.month && start.year == today.year) {
+            lv_label_set_text_fmt(label_when[row], "%02u:%02u", start.hour, start.minute);
+        } else {
+            lv_label_set_text_fmt(label_when[row], "%s %02u:%02u", weekdays[start.weekday], start.hour, start.minute);
+        }
+        lv_label_set_text(label_title[row], event.title);
+    }
+}
+
+/* AGENDA_REFRESH
+ * Bring up a reminder, and fill the rows again if the calendar or the minute has changed.
+ */
+static void agenda_refresh(lv_timer_t *timer) {
+#if defined(CONFIG_ZW_UI_BLEPAIRING)
+    // The passkey is not covered, the reminders wait in their queue until the pairing is over.
+    if (lv_screen_active() == blepairing_screen) return;
+#endif
+    calendar_event_t event;
+    if (calendar_take_reminder(&event) == 0) {
+        lv_label_set_text_fmt(label_header, "In %u min", event.reminder_min);
+        page = 0;
+        shown_minute = UINT32_MAX;
+        if (lv_screen_active() != agenda_screen) {
+            lv_screen_load_anim(agenda_screen, LV_SCR_LOAD_ANIM_FADE_IN, 300, 0, false);
+        }
+    }
+
+    if (lv_screen_active() != agenda_screen) return;
+    uint32_t now = get_current_unix_time();
+    uint32_t revision = calendar_revision();
+    if (revision == shown_revision && now / 60 == shown_minute) return;
+    shown_revision = revision;
+    shown_minute = now / 60;
+    show_rows(now);
+}
+
+void agenda_screen_event(lv_event_t * event) {
+    lv_event_code_t event_code = lv_event_get_code(event);
+
+    if (event_code == LV_EVENT_SINGLE_CLICKED) {
+        // Next page, back to the first one after the last.
+        uint32_t now = get_current_unix_time();
+        page++;
+        if (first_row_index(now) >= calendar_count()) page = 0;
+        show_rows(now);
+    } else if (event_code == LV_EVENT_SCREEN_LOAD_START) {
+        shown_minute = UINT32_MAX;
+        agenda_refresh(NULL);
+    } else if (event_code == LV_EVENT_SCREEN_UNLOADED) {
+        page = 0;
+        lv_label_set_text(label_header, "Agenda");
+    } else if (event_code == LV_EVENT_DOUBLE_CLICKED) {
+        LOG_DBG("Double click detected: returning to the menu.");
+        // A reminder can bring the agenda up before the menu was ever built.
+        if (!menu_screen_is_built()) {
+            menu_screen_init();
+        }
+        lv_screen_load_anim(menu_screen, LV_SCR_LOAD_ANIM_FADE_IN, 300, 0, false);
+    }
+}
+
+/* AGENDA_SCREEN_INIT
+ * Create the screen with the header and the rows.
+ */
+void agenda_screen_init() {
+    // Create the screen object which is the LV object with no parent.
+    agenda_screen = create_screen();
+    lv_obj_t *main_column = create_column(agenda_screen, 75, 80);
+    lv_obj_set_style_pad_row(main_column, 2, LV_PART_MAIN);
+
+    label_header = lv_label_create(main_column);
+    lv_obj_set_style_text_color(label_header, lv_palette_main(LV_PALETTE_BLUE), LV_PART_MAIN);
+    lv_obj_set_style_text_font(label_header, &lv_font_montserrat_18, LV_PART_MAIN);
+    lv_label_set_text(label_header, "Agenda");
+
+    for (int row = 0; row < AGENDA_ROWS; row++) {
+        lv_obj_t *row_obj = create_row(main_column, 100, 80 / AGENDA_ROWS);
+        lv_obj_set_flex_align(row_obj, LV_FLEX_ALIGN_START, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
+        lv_obj_set_style_pad_column(row_obj, 6, LV_PART_MAIN);
+
+        label_when[row] = lv_label_create(row_obj);
+        lv_obj_set_style_text_color(label_when[row], lv_palette_main(LV_PALETTE_GREY), LV_PART_MAIN);
+        lv_obj_set_style_text_font(label_when[row], &lv_font_montserrat_14, LV_PART_MAIN);
+        lv_label_set_text(label_when[row], "");
+
+        label_title[row] = lv_label_create(row_obj);
+        lv_obj_set_flex_grow(label_title[row], 1);
+        lv_label_set_long_mode(label_title[row], LV_LABEL_LONG_DOT);
+        lv_obj_set_style_text_color(label_title[row], lv_color_white(), LV_PART_MAIN);
+        lv_obj_set_style_text_font(label_title[row], &lv_font_montserrat_14, LV_PART_MAIN);
+        lv_label_set_text(label_title[row], "");
+    }
+    shown_minute = UINT32_MAX;
+
+    // The timer also watches the reminders, so it runs whatever screen is shown.
+    if (refresh_timer == NULL) {
+        refresh_timer = lv_timer_create(agenda_refresh, AGENDA_REFRESH_MS, NULL);
+    }
+
+    lv_obj_add_event_cb(agenda_screen, agenda_screen_event, LV_EVENT_ALL, NULL);
+    LOG_DBG("Agenda screen initialized successfully.");
+}
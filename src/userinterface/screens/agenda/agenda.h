@@ -0,0 +1,30 @@
+/** Agenda Screen Interface.
+ * Provides the next events of the calendar, and shows their reminders.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#ifndef _UI_SCREENS_AGENDA_H
+#define _UI_SCREENS_AGENDA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "lvgl.h"
+
+/* The screen object to be used in the userinterface. */
+extern lv_obj_t *agenda_screen;
+
+/* The init implementation for the agenda screen. */
+void agenda_screen_init();
+
+/* Event handler for the agenda screen gestures. */
+void agenda_screen_event(lv_event_t * event);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
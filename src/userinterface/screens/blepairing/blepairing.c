@@ -10,20 +10,32 @@
 #include <string.h>
 #include "lvgl.h"
 #include "userinterface/utils.h"
+#include "userinterface/construct.h"
+#include "userinterface/screens/home/home.h"
 #include "userinterface/screens/blepairing/blepairing.h"
 
 // Create a logger.
-LOG_MODULE_REGISTER(ZephyrWatch_UI_BLEPairing, LOG_LEVEL_INF);
+LOG_MODULE_REGISTER(ZephyrWatch_UI_BLEPairing, CONFIG_ZW_LOG_LEVEL);
 
 // Forward declarations for static functions
 static void render_title_label(lv_obj_t *flex_element);
 static void render_instruction_label(lv_obj_t *flex_element);
-static void render_pin_display(lv_obj_t *flex_element);
+static void render_pin_container(lv_obj_t *flex_element);
+static void render_pin_digit(int i);
 static void render_footer_label(lv_obj_t *flex_element);
 
-// Holds the BLE pairing screen objects.
+// The construction steps: layout, labels, PIN container, the digits, and the event handler.
+#define BLEPAIRING_BUILD_DONE (3 + 6)
+
+// Holds the BLE pairing screen objects. The screen is only set once it is complete.
 lv_obj_t *blepairing_screen;
-lv_obj_t *previous_screen;
+static lv_obj_t *previous_screen;
+static lv_obj_t *building_screen;
+static uint8_t build_stage;
+static lv_obj_t *title_row;
+static lv_obj_t *instruction_row;
+static lv_obj_t *pin_row;
+static lv_obj_t *footer_row;
 static lv_obj_t *label_title;
 static lv_obj_t *label_instruction;
 static lv_obj_t *pin_container;
@@ -32,6 +44,8 @@ static lv_obj_t *label_footer;
 
 // Current PIN code (default for demonstration)
 static char current_pin[7] = "000000";
+// PIN code to show once the screen is built.
+static char requested_pin[7];
 
 void blepairing_screen_event(lv_event_t * event) {
     lv_event_code_t event_code = lv_event_get_code(event);
@@ -40,35 +54,61 @@ void blepairing_screen_event(lv_event_t * event) {
     if (event_code == LV_EVENT_DOUBLE_CLICKED) {
         LOG_DBG("Double click detected: returning to previous screen.");
         blepairing_screen_unload();
+    } else if (event_code == LV_EVENT_DELETE) {
+        // The next pairing builds it again, the digits are not set on the deleted labels.
+        blepairing_screen = NULL;
+        build_stage = 0;
+        for (int i = 0; i < ARRAY_SIZE(pin_digits); i++) {
+            pin_digits[i] = NULL;
+        }
     }
 }
 
+/* BLEPAIRING_SCREEN_BUILD_STEP
+ * Do the next step of the construction: the layout, the labels, then one digit box per step.
+ * Returns true once the screen is complete.
+ */
+bool blepairing_screen_build_step() {
+    if (build_stage == 0) {
+        LOG_DBG("Initializing BLE pairing screen");
+
+        // Create the screen object which is the LV object with no parent.
+        building_screen = create_screen();
+
+        // Create main vertical layout container
+        lv_obj_t *main_column = create_column(building_screen, 100, 100);
+        lv_obj_set_style_pad_all(main_column, 10, LV_PART_MAIN);
+        lv_obj_set_style_pad_row(main_column, 3, LV_PART_MAIN);
+
+        // Create rows for different sections
+        title_row = create_row(main_column, 100, 15);
+        instruction_row = create_row(main_column, 100, 15);
+        pin_row = create_row(main_column, 100, 40);
+        footer_row = create_row(main_column, 100, 15);
+    } else if (build_stage == 1) {
+        render_title_label(title_row);
+        render_instruction_label(instruction_row);
+        render_footer_label(footer_row);
+    } else if (build_stage == 2) {
+        render_pin_container(pin_row);
+    } else if (build_stage < BLEPAIRING_BUILD_DONE) {
+        render_pin_digit(build_stage - 3);
+    } else if (!lv_obj_is_valid(blepairing_screen)) {
+        // Add event handler for gestures
+        lv_obj_add_event_cb(building_screen, blepairing_screen_event, LV_EVENT_ALL, NULL);
+        blepairing_screen = building_screen;
+        LOG_DBG("BLE pairing screen initialized successfully.");
+        return true;
+    } else {
+        return true;
+    }
+    build_stage++;
+    return false;
+}
+
 void blepairing_screen_init() {
-    LOG_DBG("Initializing BLE pairing screen");
-
-    // Create the screen object which is the LV object with no parent.
-    blepairing_screen = create_screen();
-
-    // Create main vertical layout container
-    lv_obj_t *main_column = create_column(blepairing_screen, 100, 100);
-    lv_obj_set_style_pad_all(main_column, 10, LV_PART_MAIN);
-    lv_obj_set_style_pad_row(main_column, 3, LV_PART_MAIN);
-
-    // Create rows for different sections
-    lv_obj_t *title_row = create_row(main_column, 100, 15);
-    lv_obj_t *instruction_row = create_row(main_column, 100, 15);
-    lv_obj_t *pin_row = create_row(main_column, 100, 40);
-    lv_obj_t *footer_row = create_row(main_column, 100, 15);
-
-    // Render all components
-    render_title_label(title_row);
-    render_instruction_label(instruction_row);
-    render_pin_display(pin_row);
-    render_footer_label(footer_row);
-
-    // Add event handler for gestures
-    lv_obj_add_event_cb(blepairing_screen, blepairing_screen_event, LV_EVENT_ALL, NULL);
-    LOG_DBG("BLE pairing screen initialized successfully.");
+    while (!blepairing_screen_build_step()) {
+    }
 }
 
 static void render_title_label(lv_obj_t *flex_element) {
@@ -101,7 +141,7 @@ static void render_instruction_label(lv_obj_t *flex_element) {
     lv_obj_set_style_text_color(label_instruction, lv_color_white(), LV_PART_MAIN | LV_STATE_DEFAULT);
 }
 
-static void render_pin_display(lv_obj_t *flex_element) {
+static void render_pin_container(lv_obj_t *flex_element) {
     // Create a container for the PIN digits with horizontal layout
     pin_container = lv_obj_create(flex_element);
     lv_obj_set_size(pin_container, LV_SIZE_CONTENT, LV_SIZE_CONTENT);
@@ -117,33 +157,32 @@ static void render_pin_display(lv_obj_t *flex_element) {
     // Remove background and border from container
     lv_obj_set_style_bg_opa(pin_container, LV_OPA_TRANSP, LV_PART_MAIN);
     lv_obj_set_style_border_opa(pin_container, LV_OPA_TRANSP, LV_PART_MAIN);
-    
-    // Create individual digit displays
-    for (int i = 0; i < 6; i++) {
-        // Create a container for each digit
-        lv_obj_t *digit_box = lv_obj_create(pin_container);
-        lv_obj_set_size(digit_box, 25, 45);
-
-        // Style the digit box with rounded corners and shadow
-        lv_obj_set_style_radius(digit_box, 8, LV_PART_MAIN);
-        lv_obj_set_style_bg_color(digit_box, lv_color_hex(0x404040), LV_PART_MAIN);
-        lv_obj_set_style_bg_opa(digit_box, LV_OPA_100, LV_PART_MAIN);
-        lv_obj_set_style_border_color(digit_box, lv_color_hex(0x555555), LV_PART_MAIN);
-        lv_obj_set_style_border_width(digit_box, 2, LV_PART_MAIN);
-        lv_obj_set_style_border_opa(digit_box, LV_OPA_50, LV_PART_MAIN);
-
-        // Create the digit label
-        pin_digits[i] = lv_label_create(digit_box);
-        lv_label_set_text_fmt(pin_digits[i], "%c", current_pin[i]);
-
-        // Center the digit in its box
-        lv_obj_set_align(pin_digits[i], LV_ALIGN_CENTER);
+}
 
-        // Style the digit text
-        lv_obj_set_style_text_font(pin_digits[i], &lv_font_montserrat_14, LV_PART_MAIN | LV_STATE_DEFAULT);
-        lv_obj_set_style_text_color(pin_digits[i], lv_color_white(), LV_PART_MAIN | LV_STATE_DEFAULT);
-        lv_obj_set_style_text_align(pin_digits[i], LV_TEXT_ALIGN_CENTER, LV_PART_MAIN | LV_STATE_DEFAULT);
-    }
+static void render_pin_digit(int i) {
+    // Create a container for each digit
+    lv_obj_t *digit_box = lv_obj_create(pin_container);
+    lv_obj_set_size(digit_box, 25, 45);
+
+    // Style the digit box with rounded corners and shadow
+    lv_obj_set_style_radius(digit_box, 8, LV_PART_MAIN);
+    lv_obj_set_style_bg_color(digit_box, lv_color_hex(0x404040), LV_PART_MAIN);
+    lv_obj_set_style_bg_opa(digit_box, LV_OPA_100, LV_PART_MAIN);
+    lv_obj_set_style_border_color(digit_box, lv_color_hex(0x555555), LV_PART_MAIN);
+    lv_obj_set_style_border_width(digit_box, 2, LV_PART_MAIN);
+    lv_obj_set_style_border_opa(digit_box, LV_OPA_50, LV_PART_MAIN);
+
+    // Create the digit label
+    pin_digits[i] = lv_label_create(digit_box);
+    lv_label_set_text_fmt(pin_digits[i], "%c", current_pin[i]);
+
+    // Center the digit in its box
+    lv_obj_set_align(pin_digits[i], LV_ALIGN_CENTER);
+
+    // Style the digit text
+    lv_obj_set_style_text_font(pin_digits[i], &lv_font_montserrat_14, LV_PART_MAIN | LV_STATE_DEFAULT);
+    lv_obj_set_style_text_color(pin_digits[i], lv_color_white(), LV_PART_MAIN | LV_STATE_DEFAULT);
+    lv_obj_set_style_text_align(pin_digits[i], LV_TEXT_ALIGN_CENTER, LV_PART_MAIN | LV_STATE_DEFAULT);
 }
 
 static void render_footer_label(lv_obj_t *flex_element) {
@@ -189,8 +228,10 @@ uint8_t blepairing_screen_set_pin(const char *pin_code) {
 }
 
 void blepairing_screen_load() {
-    // Save the previous screen to unload afterwards.
-    previous_screen = lv_scr_act();
+    // Save the previous screen to unload afterwards, a new passkey keeps the first one.
+    if (lv_screen_active() != blepairing_screen) {
+        previous_screen = lv_screen_active();
+    }
     if (!lv_obj_is_valid(blepairing_screen)) {
         blepairing_screen_init();
     }
@@ -198,7 +239,44 @@ void blepairing_screen_load() {
     lv_screen_load_anim(blepairing_screen, LV_SCR_LOAD_ANIM_FADE_IN, 300, 0, false);
 }
 
+/* BLEPAIRING_SCREEN_HIDE_STEP
+ * Nothing to build for the unload, it only takes its turn in the construction queue.
+ */
+static bool blepairing_screen_hide_step() {
+    return true;
+}
+
+/* BLEPAIRING_SCREEN_HIDDEN
+ * Go back to the previous screen if the pairing screen is the active one. The pairing screen is
+ * kept for the next pairing, the previous screen is not ours to delete.
+ */
+static void blepairing_screen_hidden() {
+    if (blepairing_screen == NULL || lv_screen_active() != blepairing_screen) return;
+    if (!lv_obj_is_valid(previous_screen)) {
+        previous_screen = home_screen;
+    }
+    lv_screen_load_anim(previous_screen, LV_SCR_LOAD_ANIM_FADE_OUT, 300, 0, false);
+}
+
 void blepairing_screen_unload() {
-    // Load the previous screen.
-    lv_screen_load_anim(previous_screen, LV_SCR_LOAD_ANIM_FADE_OUT, 300, 0, true);
-}
\ No newline at end of file
+    // A passkey which is not on the screen yet is not shown any more, then the unload runs in the
+    // UI thread after the constructions requested before it.
+    ui_construct_cancel(blepairing_screen_build_step);
+    if (ui_construct_request(blepairing_screen_hide_step, blepairing_screen_hidden)) {
+        LOG_WRN("Pairing screen unload couldn't be queued.");
+    }
+}
+
+/* BLEPAIRING_SCREEN_SHOWN
+ * The screen is complete: put the requested PIN on it and load it.
+ */
+static void blepairing_screen_shown() {
+    blepairing_screen_set_pin(requested_pin);
+    blepairing_screen_load();
+}
+
+void blepairing_screen_show(const char *pin_code) {
+    strncpy(requested_pin, pin_code, 6);
+    requested_pin[6] = '\0';
+    ui_construct_request(blepairing_screen_build_step, blepairing_screen_shown);
+}
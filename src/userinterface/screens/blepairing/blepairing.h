@@ -13,6 +13,7 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include "lvgl.h"
 
 /* The screen object to be used in the userinterface. */
@@ -21,12 +22,23 @@ extern lv_obj_t *blepairing_screen;
 /* The init implementation for the BLE Pairing screen. */
 void blepairing_screen_init();
 
+/* Do the next construction step of the BLE Pairing screen. Returns true once it is complete. */
+bool blepairing_screen_build_step();
+
+/** Build the screen in steps in the UI thread, then show the PIN code on it and load it. It can
+ * be called from any thread.
+ * @param pin_code The 6-digit PIN code.
+ * @return void
+ */
+void blepairing_screen_show(const char *pin_code);
+
 /** Load the BLE pairing screen.
  * @return void
  */
 void blepairing_screen_load();
 
-/** Unload the BLE pairing screen. 
+/** Go back to the previous screen if the pairing screen is shown, and drop a passkey which is
+ * not shown yet. It can be called from any thread, the screen is changed in the UI thread.
  * @return void
  */
 void blepairing_screen_unload();
@@ -48,16 +48,12 @@ void home_screen_event(lv_event_t * event) {
 
     // Handle gesture events using the callback
     if (event_code == LV_EVENT_GESTURE) {
-        lv_dir_t dir = lv_indev_get_gesture_dir(lv_indev_active());
+        lv_dir_t dir = get_gesture_dir(event);
 
         // Check for bottom-to-top gesture to open menu.
-        if (dir == LV_DIR_TOP) {
-            // Initialize menu screen if not already done.
-            if (!lv_obj_is_valid(menu_screen)) {
-                menu_screen_init();
-            }
-            // Create a smooth slide transition from right to left
-            lv_screen_load_anim(menu_screen, LV_SCR_LOAD_ANIM_MOVE_TOP, 300, 0, false);
+        if (IS_ENABLED(CONFIG_ZW_UI_MENU) && dir == LV_DIR_TOP) {
+            // The menu is usually built during the idle time already.
+            menu_screen_open();
         }
     }
 }
@@ -5,19 +5,24 @@
  * @maintainer electricalgorithm @ github
  */
 
- #include <zephyr/logging/log.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
 #include "lvgl.h"
 
 #include "misc/lv_event.h"
+#include "benchmark/benchmark.h"
 #include "userinterface/userinterface.h"
 #include "userinterface/utils.h"
 #include "userinterface/screens/home/home.h"
+#include "userinterface/screens/stephistory/stephistory.h"
+#include "userinterface/screens/worldclock/worldclock.h"
+#include "userinterface/screens/agenda/agenda.h"
 
 // Define the maximum number of applications allowed.
 #define MAX_APPLICATIONS 10
 
 // Create a logger.
-LOG_MODULE_REGISTER(ZephyrWatch_UI_Menu, LOG_LEVEL_INF);
+LOG_MODULE_REGISTER(ZephyrWatch_UI_Menu, CONFIG_ZW_LOG_LEVEL);
 
 // Structure to hold application information
 typedef struct {
@@ -30,10 +35,68 @@ typedef struct {
 static application_t applications[MAX_APPLICATIONS];
 static uint8_t application_count = 0;
 
-// The screen container.
+// The screen container. It is only set once the menu is complete.
 lv_obj_t *menu_screen;
+static lv_obj_t *menu_building_screen;
+static lv_obj_t *menu_column;
+static lv_obj_t *menu_title_row;
 static lv_obj_t *menu_list;
 
+// The applications of the menu, with the init of their screens. Placeholders have no screen.
+typedef struct {
+    lv_obj_t **screen;
+    void (*init)();
+    char *name;
+} menu_application_t;
+
+static const menu_application_t menu_applications[] = {
+#if defined(CONFIG_ZW_UI_STEPHISTORY)
+    { &stephistory_screen, stephistory_screen_init, "Steps" },
+#endif
+#if defined(CONFIG_ZW_UI_WORLDCLOCK)
+    { &worldclock_screen, worldclock_screen_init, "World Clock" },
+#endif
+#if defined(CONFIG_ZW_UI_AGENDA)
+    { &agenda_screen, agenda_screen_init, "Agenda" },
+#endif
+    { NULL, NULL, "Settings" },
+    { NULL, NULL, "Stopwatch" },
+    { NULL, NULL, "Weather" },
+    { NULL, NULL, "Music" },
+};
+
+// The construction is done in steps, so it can be spread over the idle frames.
+enum {
+    MENU_BUILD_SKELETON,
+    MENU_BUILD_APPLICATIONS,
+    MENU_BUILD_ITEMS,
+    MENU_BUILD_DONE,
+};
+static uint8_t build_stage = MENU_BUILD_SKELETON;
+static uint8_t build_index;
+
+#if defined(CONFIG_ZW_RENDER_STATS)
+// Time from the swipe on the home screen to the start of the slide animation. The first one
+// since the boot is kept apart, it shows whether the menu was built in advance.
+static BENCHMARK_METRIC_DEFINE(menu_open_first, "Menu swipe to animation (first)", "us");
+static BENCHMARK_METRIC_DEFINE(menu_open_later, "Menu swipe to animation", "us");
+static uint32_t open_start_cycles;
+static bool open_armed;
+static bool opened_before;
+
+/* MENU_LOAD_STARTED
+ * The slide animation of the menu has started. Only the loads armed by a swipe are measured, not
+ * the returns from the applications.
+ */
+static void menu_load_started(lv_event_t *event) {
+    if (!open_armed) return;
+    open_armed = false;
+    uint32_t latency_us = k_cyc_to_us_floor32(k_cycle_get_32() - open_start_cycles);
+    benchmark_metric_record(opened_before ? &menu_open_later : &menu_open_first, latency_us);
+    opened_before = true;
+}
+#endif
+
 /**
  * Register an application to be displayed in the menu
  * @param screen The screen object for the application
@@ -126,37 +189,26 @@ static void create_menu_item(lv_obj_t *parent, const char *app_name, uint32_t ap
     LOG_DBG("Menu item created for app index: %d, app name: %s.", app_index, app_name);
 }
 
-/* RENDER_MENU_ITEMS
- * Render all registered applications as menu items.
+/* MENU_SCREEN_BUILD_SKELETON
+ * Create the screen, its title and the empty list.
  */
-static void render_menu_items() {
-    for (uint8_t i = 0; i < application_count; i++) {
-        if (applications[i].is_registered) {
-            create_menu_item(menu_list, applications[i].name, i);
-        }
-    }
-}
-
-/* MENU_SCREEN_INIT 
- * Create the menu screen using LVGL definitions.
- */
-void menu_screen_init() {
+static void menu_screen_build_skeleton() {
     // Create the screen object which is the LV object with no parent.
-    menu_screen = create_screen();
+    menu_building_screen = create_screen();
     
     // Create a vertical flex layout container centered in the screen.
-    lv_obj_t *main_column = create_column(menu_screen, 100, 100);
+    menu_column = create_column(menu_building_screen, 100, 100);
 
     // Create a title row
-    lv_obj_t *title_row = create_row(main_column, 100, 15);
-    lv_obj_t *title_label = lv_label_create(title_row);
+    menu_title_row = create_row(menu_column, 100, 15);
+    lv_obj_t *title_label = lv_label_create(menu_title_row);
     lv_label_set_text(title_label, "Menu");
     lv_obj_set_style_text_color(title_label, lv_color_white(), LV_PART_MAIN);
     lv_obj_set_style_text_font(title_label, &lv_font_montserrat_18, LV_PART_MAIN);
     lv_obj_center(title_label);
 
     // Create a scrollable list container for menu items
-    menu_list = create_column(main_column, 100, 80);
+    menu_list = create_column(menu_column, 100, 80);
     lv_obj_set_style_pad_all(menu_list, 10, LV_PART_MAIN);
     lv_obj_set_style_pad_row(menu_list, 8, LV_PART_MAIN);
 
@@ -173,20 +225,85 @@ void menu_screen_init() {
     // Set flex layout to column with proper alignment
     lv_obj_set_flex_flow(menu_list, LV_FLEX_FLOW_COLUMN);
     lv_obj_set_flex_align(menu_list, LV_FLEX_ALIGN_START, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
+}
+
+/* MENU_SCREEN_BUILD_STEP
+ * Do the next step of the construction: the skeleton, then the screen of one application, then
+ * one menu item. Returns true once the menu is complete.
+ */
+bool menu_screen_build_step() {
+    switch (build_stage) {
+    case MENU_BUILD_SKELETON:
+        menu_screen_build_skeleton();
+        build_stage = MENU_BUILD_APPLICATIONS;
+        build_index = 0;
+        return false;
+
+    case MENU_BUILD_APPLICATIONS:
+        // Register the applications, then some examples.
+        if (build_index < ARRAY_SIZE(menu_applications)) {
+            const menu_application_t *app = &menu_applications[build_index++];
+            if (app->init != NULL && !lv_obj_is_valid(*app->screen)) app->init();
+            register_application(app->screen != NULL ? *app->screen : NULL, app->name);
+            return false;
+        }
+        build_stage = MENU_BUILD_ITEMS;
+        build_index = 0;
+        __fallthrough;
+
+    case MENU_BUILD_ITEMS:
+        // Render the registered applications, one item per step.
+        if (build_index < application_count) {
+            if (applications[build_index].is_registered) {
+                create_menu_item(menu_list, applications[build_index].name, build_index);
+            }
+            build_index++;
+            return false;
+        }
 
-    // Register some example applications
-    register_application(NULL, "Settings");
-    register_application(NULL, "Stopwatch");
-    register_application(NULL, "Weather");
-    register_application(NULL, "Music");
+        // Add spacing between elements
+        lv_obj_set_style_pad_row(menu_column, 5, LV_PART_MAIN);
+
+        // Add gesture detection only to the title area for going back to home screen
+        lv_obj_add_event_cb(menu_title_row, menu_screen_event, LV_EVENT_ALL, NULL);
+#if defined(CONFIG_ZW_RENDER_STATS)
+        lv_obj_add_event_cb(menu_building_screen, menu_load_started, LV_EVENT_SCREEN_LOAD_START, NULL);
+#endif
+        menu_screen = menu_building_screen;
+        build_stage = MENU_BUILD_DONE;
+        LOG_DBG("Menu screen initialized successfully.");
+        return true;
+
+    default:
+        return true;
+    }
+}
 
-    // Render all registered applications
-    render_menu_items();
+/* MENU_SCREEN_IS_BUILT
+ * The menu can be loaded once all the steps are done.
+ */
+bool menu_screen_is_built() {
+    return build_stage == MENU_BUILD_DONE;
+}
 
-    // Add spacing between elements
-    lv_obj_set_style_pad_row(main_column, 5, LV_PART_MAIN);
+/* MENU_SCREEN_INIT 
+ * Create the menu screen using LVGL definitions. The steps not done yet are all done at once.
+ */
+void menu_screen_init() {
+    while (!menu_screen_build_step()) {
+    }
+}
 
-    // Add gesture detection only to the title area for going back to home screen
-    lv_obj_add_event_cb(title_row, menu_screen_event, LV_EVENT_ALL, NULL);
-    LOG_DBG("Menu screen initialized successfully.");
+/* MENU_SCREEN_OPEN
+ * Finish the menu if the idle time was not enough to build it, and slide it in.
+ */
+void menu_screen_open() {
+#if defined(CONFIG_ZW_RENDER_STATS)
+    open_start_cycles = k_cycle_get_32();
+    open_armed = true;
+#endif
+    if (!menu_screen_is_built()) {
+        menu_screen_init();
+    }
+    lv_screen_load_anim(menu_screen, LV_SCR_LOAD_ANIM_MOVE_TOP, 300, 0, false);
 }
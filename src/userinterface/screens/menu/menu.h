@@ -12,6 +12,7 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include "lvgl.h"
 
 /* The screen object to be used in the userinterface. */
@@ -20,6 +21,15 @@ extern lv_obj_t *menu_screen;
 /* The init implementation for the menu screen. */
 void menu_screen_init();
 
+/* Do the next construction step of the menu. Returns true once it is complete. */
+bool menu_screen_build_step();
+
+/* Whether all the construction steps of the menu are done. */
+bool menu_screen_is_built();
+
+/* Complete the menu if needed and slide it in. */
+void menu_screen_open();
+
 /* Event handler for menu screen gestures. It is used to detect non-list events. */
 void menu_screen_event(lv_event_t * event);
 
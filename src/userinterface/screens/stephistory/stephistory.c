@@ -0,0 +1,206 @@
+/** Step History Screen Implementation.
+ * The records are aggregated into one bucket per pixel column of the chart as they arrive. A
+ * bucket keeps the minimum, the maximum and the sum of the steps of its records. Each zoom level
+ * puts four times more records into a bucket than the one below, so the chart always draws the
+ * same number of points whatever the range is. The buckets of a level are a ring, and the chart
+ * reads the minimum and maximum rings directly as its series.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "lvgl.h"
+
+#include "history/history.h"
+#include "userinterface/utils.h"
+#include "userinterface/screens/menu/menu.h"
+#include "userinterface/screens/stephistory/stephistory.h"
+
+LOG_MODULE_REGISTER(ZephyrWatch_UI_StepHistory, CONFIG_ZW_LOG_LEVEL);
+
+#define STEPHISTORY_COLUMNS CONFIG_ZW_UI_STEPHISTORY_COLUMNS
+#define STEPHISTORY_LEVELS 3
+#define STEPHISTORY_LEVEL_FACTOR 4
+#define STEPHISTORY_REFRESH_MS 1000
+#define STEPHISTORY_CHART_HEIGHT 100
+
+// The buckets of a zoom level. The newest bucket is the one with the head index.
+typedef struct {
+    int32_t min[STEPHISTORY_COLUMNS];
+    int32_t max[STEPHISTORY_COLUMNS];
+    int32_t sum[STEPHISTORY_COLUMNS];
+    uint32_t records_per_bucket;
+    uint32_t head;
+    bool started;
+} stephistory_level_t;
+
+static stephistory_level_t levels[STEPHISTORY_LEVELS];
+static uint32_t next_seq;
+static bool levels_changed;
+static uint8_t shown_level;
+static lv_timer_t *refresh_timer;
+
+// Holds the step history screen objects.
+lv_obj_t *stephistory_screen;
+static lv_obj_t *label_range;
+static lv_obj_t *label_total;
+static lv_obj_t *chart;
+static lv_chart_series_t *series_max;
+static lv_chart_series_t *series_min;
+
+/* CLEAR_BUCKET
+ * An empty bucket is not drawn.
+ */
+static void clear_bucket(stephistory_level_t *level, uint32_t index) {
+    uint32_t slot = index % STEPHISTORY_COLUMNS;
+    level->min[slot] = LV_CHART_POINT_NONE;
+    level->max[slot] = LV_CHART_POINT_NONE;
+    level->sum[slot] = 0;
+}
+
+/* STEPHISTORY_ADD_RECORD
+ * Move the head of every level to the bucket of the record, emptying the skipped buckets, and
+ * add the steps to that bucket.
+ */
+void stephistory_add_record(uint32_t seq, uint16_t steps) {
+    for (int i = 0; i < STEPHISTORY_LEVELS; i++) {
+        stephistory_level_t *level = &levels[i];
+        uint32_t index = seq / level->records_per_bucket;
+
+        if (level->started && (int32_t)(index - level->head) < 0) {
+            // Older than the newest bucket: only added if the bucket is still in the ring.
+            if (level->head - index >= STEPHISTORY_COLUMNS) continue;
+        } else if (!level->started || index - level->head >= STEPHISTORY_COLUMNS) {
+            for (uint32_t slot = 0; slot < STEPHISTORY_COLUMNS; slot++) clear_bucket(level, slot);
+            level->head = index;
+            level->started = true;
+        } else {
+            while (level->head != index) {
+                level->head++;
+                clear_bucket(level, level->head);
+            }
+        }
+
+        uint32_t slot = index % STEPHISTORY_COLUMNS;
+        if (level->min[slot] == LV_CHART_POINT_NONE || steps < level->min[slot]) level->min[slot] = steps;
+        if (level->max[slot] == LV_CHART_POINT_NONE || steps > level->max[slot]) level->max[slot] = steps;
+        level->sum[slot] += steps;
+    }
+    levels_changed = true;
+}
+
+/* SHOW_LEVEL
+ * Point the series to the rings of the level, starting after the newest bucket.
+ */
+static void show_level(uint8_t level_index) {
+    stephistory_level_t *level = &levels[level_index];
+    int32_t highest = 0;
+    int32_t total = 0;
+    for (int slot = 0; slot < STEPHISTORY_COLUMNS; slot++) {
+        if (level->max[slot] != LV_CHART_POINT_NONE) highest = MAX(highest, level->max[slot]);
+        total += level->sum[slot];
+    }
+
+    uint32_t start = (level->head + 1) % STEPHISTORY_COLUMNS;
+    lv_chart_set_ext_y_array(chart, series_max, level->max);
+    lv_chart_set_ext_y_array(chart, series_min, level->min);
+    lv_chart_set_x_start_point(chart, series_max, start);
+    lv_chart_set_x_start_point(chart, series_min, start);
+    lv_chart_set_range(chart, LV_CHART_AXIS_PRIMARY_Y, 0, MAX(highest, 1));
+    lv_chart_refresh(chart);
+
+    uint32_t range_hours = STEPHISTORY_COLUMNS * level->records_per_bucket * CONFIG_ZW_HISTORY_INTERVAL_MIN / 60;
+    if (range_hours >= 48) lv_label_set_text_fmt(label_range, "Last %u days", range_hours / 24);
+    else lv_label_set_text_fmt(label_range, "Last %u hours", range_hours);
+    lv_label_set_text_fmt(label_total, "%d steps", total);
+}
+
+/* STEPHISTORY_REFRESH
+ * Add the new records of the history, and redraw the chart if it is on the screen.
+ */
+static void stephistory_refresh(lv_timer_t *timer) {
+    history_record_t record;
+    uint32_t end = history_next_seq();
+    if (end - next_seq > end - history_first_seq()) {
+        next_seq = history_first_seq();
+    }
+    for (; next_seq != end; next_seq++) {
+        if (history_read(next_seq, &record) == 0) {
+            stephistory_add_record(next_seq, record.steps);
+        }
+    }
+
+    if (levels_changed && lv_screen_active() == stephistory_screen) {
+        levels_changed = false;
+        show_level(shown_level);
+    }
+}
+
+void stephistory_screen_event(lv_event_t * event) {
+    lv_event_code_t event_code = lv_event_get_code(event);
+
+    // A tap zooms out, after the widest range it starts again from the narrowest.
+    if (event_code == LV_EVENT_SINGLE_CLICKED) {
+        shown_level = (shown_level + 1) % STEPHISTORY_LEVELS;
+        show_level(shown_level);
+    } else if (event_code == LV_EVENT_SCREEN_LOAD_START) {
+        show_level(shown_level);
+    } else if (event_code == LV_EVENT_DOUBLE_CLICKED) {
+        LOG_DBG("Double click detected: returning to the menu.");
+        lv_screen_load_anim(menu_screen, LV_SCR_LOAD_ANIM_FADE_IN, 300, 0, false);
+    }
+}
+
+/* STEPHISTORY_SCREEN_INIT
+ * Create the screen and start following the history.
+ */
+void stephistory_screen_init() {
+    // Create the screen object which is the LV object with no parent.
+    stephistory_screen = create_screen();
+    lv_obj_t *main_column = create_column(stephistory_screen, 100, 100);
+    lv_obj_set_style_pad_row(main_column, 5, LV_PART_MAIN);
+
+    lv_obj_t *range_row = create_row(main_column, 100, 15);
+    label_range = lv_label_create(range_row);
+    lv_obj_set_style_text_color(label_range, lv_color_white(), LV_PART_MAIN);
+    lv_obj_set_style_text_font(label_range, &lv_font_montserrat_14, LV_PART_MAIN);
+    lv_obj_center(label_range);
+
+    // One point per pixel column, the maximum over the minimum of the buckets.
+    chart = lv_chart_create(main_column);
+    lv_obj_set_size(chart, STEPHISTORY_COLUMNS, STEPHISTORY_CHART_HEIGHT);
+    lv_chart_set_type(chart, LV_CHART_TYPE_LINE);
+    lv_chart_set_point_count(chart, STEPHISTORY_COLUMNS);
+    lv_chart_set_div_line_count(chart, 0, 0);
+    lv_obj_set_style_size(chart, 0, 0, LV_PART_INDICATOR);
+    lv_obj_set_style_pad_all(chart, 0, LV_PART_MAIN);
+    lv_obj_set_style_bg_opa(chart, LV_OPA_TRANSP, LV_PART_MAIN);
+    lv_obj_set_style_border_width(chart, 0, LV_PART_MAIN);
+    lv_obj_remove_flag(chart, LV_OBJ_FLAG_CLICKABLE);
+    series_max = lv_chart_add_series(chart, lv_palette_main(LV_PALETTE_BLUE), LV_CHART_AXIS_PRIMARY_Y);
+    series_min = lv_chart_add_series(chart, lv_palette_darken(LV_PALETTE_BLUE, 3), LV_CHART_AXIS_PRIMARY_Y);
+
+    lv_obj_t *total_row = create_row(main_column, 100, 15);
+    label_total = lv_label_create(total_row);
+    lv_obj_set_style_text_color(label_total, lv_color_white(), LV_PART_MAIN);
+    lv_obj_set_style_text_font(label_total, &lv_font_montserrat_18, LV_PART_MAIN);
+    lv_obj_center(label_total);
+
+    // Aggregate the records kept so far, then the new ones as they come. The buckets outlive
+    // the screen, they are only filled once.
+    if (refresh_timer == NULL) {
+        uint32_t records_per_bucket = 1;
+        for (int i = 0; i < STEPHISTORY_LEVELS; i++) {
+            levels[i].records_per_bucket = records_per_bucket;
+            records_per_bucket *= STEPHISTORY_LEVEL_FACTOR;
+        }
+        next_seq = history_first_seq();
+        refresh_timer = lv_timer_create(stephistory_refresh, STEPHISTORY_REFRESH_MS, NULL);
+    }
+    stephistory_refresh(NULL);
+
+    lv_obj_add_event_cb(stephistory_screen, stephistory_screen_event, LV_EVENT_ALL, NULL);
+    LOG_DBG("Step history screen initialized successfully.");
+}
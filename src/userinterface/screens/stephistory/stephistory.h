@@ -0,0 +1,34 @@
+/** Step History Screen Interface.
+ * Provides a chart of the steps from the activity history, with three zoom levels.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#ifndef _UI_SCREENS_STEPHISTORY_H
+#define _UI_SCREENS_STEPHISTORY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "lvgl.h"
+
+/* The screen object to be used in the userinterface. */
+extern lv_obj_t *stephistory_screen;
+
+/* The init implementation for the step history screen. */
+void stephistory_screen_init();
+
+/* Event handler for the step history screen gestures. */
+void stephistory_screen_event(lv_event_t * event);
+
+/* Add the steps of a history record to the buckets of every zoom level. */
+void stephistory_add_record(uint32_t seq, uint16_t steps);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
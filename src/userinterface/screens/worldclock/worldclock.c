@@ -0,0 +1,174 @@
+/** World Clock Screen Implementation.
+ * The UTC minute is broken down once, and every zone is derived from it by adding its offset in
+ * minutes, the day moving by at most one. The offset of a zone is cached together with the next
+ * instant it changes, so the daylight saving rules are only evaluated at the transitions. A label
+ * is only set when its hour, minute or weekday is different from the one it shows.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "lvgl.h"
+
+#include "datetime/datetime.h"
+#include "userinterface/utils.h"
+#include "userinterface/screens/menu/menu.h"
+#include "userinterface/screens/worldclock/worldclock.h"
+
+LOG_MODULE_REGISTER(ZephyrWatch_UI_WorldClock, CONFIG_ZW_LOG_LEVEL);
+
+#define WORLDCLOCK_REFRESH_MS 1000
+#define MINUTES_PER_DAY 1440
+
+/* Names of the Weekdays */
+static const char* weekdays[] = { "SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT" };
+
+// A zone with its cached offset, and the values its labels show.
+typedef struct {
+    const char *name;
+    int16_t standard_offset_minutes;
+    datetime_dst_rule_t rule;
+    int32_t offset_minutes;
+    uint32_t next_change;
+    int16_t shown_minute_of_day;
+    int8_t shown_weekday;
+    lv_obj_t *label_time;
+    lv_obj_t *label_day;
+} worldclock_zone_t;
+
+static worldclock_zone_t zones[] = {
+    { .name = "UTC", .standard_offset_minutes = 0, .rule = DATETIME_DST_NONE },
+    { .name = "London", .standard_offset_minutes = 0, .rule = DATETIME_DST_EU },
+    { .name = "Berlin", .standard_offset_minutes = 60, .rule = DATETIME_DST_EU },
+    { .name = "New York", .standard_offset_minutes = -300, .rule = DATETIME_DST_US },
+    { .name = "Delhi", .standard_offset_minutes = 330, .rule = DATETIME_DST_NONE },
+    { .name = "Tokyo", .standard_offset_minutes = 540, .rule = DATETIME_DST_NONE },
+};
+
+// The UTC minute the labels were computed for.
+static uint32_t computed_minute = UINT32_MAX;
+static lv_timer_t *refresh_timer;
+
+/* WORLDCLOCK_INVALIDATE_OFFSETS
+ * Compute the offsets again on the next update. A time set backwards across a transition would
+ * otherwise keep the offset from after it until the next transition.
+ */
+static void worldclock_invalidate_offsets() {
+    for (int i = 0; i < ARRAY_SIZE(zones); i++) {
+        zones[i].next_change = 0;
+    }
+}
+
+// Holds the world clock screen objects.
+lv_obj_t *worldclock_screen;
+
+/* WORLDCLOCK_UPDATE
+ * Derive the local time of every zone from the UTC minute, and set the labels that changed.
+ */
+static void worldclock_update(uint32_t unix_time) {
+    uint32_t utc_minutes = unix_time / 60;
+    int32_t utc_minute_of_day = utc_minutes % MINUTES_PER_DAY;
+    uint8_t utc_weekday = (utc_minutes / MINUTES_PER_DAY + 4) % 7; // 1970-01-01 = Thursday
+
+    for (int i = 0; i < ARRAY_SIZE(zones); i++) {
+        worldclock_zone_t *zone = &zones[i];
+        if (unix_time >= zone->next_change) {
+            zone->offset_minutes = datetime_zone_offset(unix_time, zone->standard_offset_minutes,
+                                                        zone->rule, &zone->next_change) / 60;
+            LOG_DBG("%s is at UTC%+d min until %u.", zone->name, zone->offset_minutes, zone->next_change);
+        }
+
+        int32_t minute_of_day = utc_minute_of_day + zone->offset_minutes;
+        int8_t weekday = utc_weekday;
+        if (minute_of_day < 0) {
+            minute_of_day += MINUTES_PER_DAY;
+            weekday = (weekday + 6) % 7;
+        } else if (minute_of_day >= MINUTES_PER_DAY) {
+            minute_of_day -= MINUTES_PER_DAY;
+            weekday = (weekday + 1) % 7;
+        }
+
+        if (minute_of_day != zone->shown_minute_of_day) {
+            zone->shown_minute_of_day = minute_of_day;
+            lv_label_set_text_fmt(zone->label_time, "%02d:%02d", minute_of_day / 60, minute_of_day % 60);
+        }
+        if (weekday != zone->shown_weekday) {
+            zone->shown_weekday = weekday;
+            lv_label_set_text(zone->label_day, weekdays[weekday]);
+        }
+    }
+}
+
+/* WORLDCLOCK_REFRESH
+ * Update the zones once the minute has changed, while the screen is shown.
+ */
+static void worldclock_refresh(lv_timer_t *timer) {
+    uint32_t unix_time = get_current_unix_time();
+    if (lv_screen_active() != worldclock_screen || unix_time / 60 == computed_minute) {
+        return;
+    }
+    if (unix_time / 60 < computed_minute) {
+        worldclock_invalidate_offsets();
+    }
+    computed_minute = unix_time / 60;
+    worldclock_update(unix_time);
+}
+
+void worldclock_screen_event(lv_event_t * event) {
+    lv_event_code_t event_code = lv_event_get_code(event);
+
+    if (event_code == LV_EVENT_SCREEN_LOAD_START) {
+        // The time may have been set while the screen was hidden.
+        worldclock_invalidate_offsets();
+        computed_minute = get_current_unix_time() / 60;
+        worldclock_update(get_current_unix_time());
+    } else if (event_code == LV_EVENT_DOUBLE_CLICKED) {
+        LOG_DBG("Double click detected: returning to the menu.");
+        lv_screen_load_anim(menu_screen, LV_SCR_LOAD_ANIM_FADE_IN, 300, 0, false);
+    }
+}
+
+/* CREATE_ZONE_LABEL
+ * Create a white label in the row.
+ */
+static lv_obj_t *create_zone_label(lv_obj_t *row, const lv_font_t *font, const char *text) {
+    lv_obj_t *label = lv_label_create(row);
+    lv_obj_set_style_text_color(label, lv_color_white(), LV_PART_MAIN);
+    lv_obj_set_style_text_font(label, font, LV_PART_MAIN);
+    lv_label_set_text(label, text);
+    return label;
+}
+
+/* WORLDCLOCK_SCREEN_INIT
+ * Create the screen with a row for every zone.
+ */
+void worldclock_screen_init() {
+    // Create the screen object which is the LV object with no parent.
+    worldclock_screen = create_screen();
+    lv_obj_t *main_column = create_column(worldclock_screen, 70, 80);
+    lv_obj_set_style_pad_row(main_column, 2, LV_PART_MAIN);
+
+    for (int i = 0; i < ARRAY_SIZE(zones); i++) {
+        worldclock_zone_t *zone = &zones[i];
+        lv_obj_t *row = create_row(main_column, 100, 100 / ARRAY_SIZE(zones));
+        lv_obj_set_flex_align(row, LV_FLEX_ALIGN_SPACE_BETWEEN, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
+        create_zone_label(row, &lv_font_montserrat_14, zone->name);
+        zone->label_time = create_zone_label(row, &lv_font_montserrat_18, "--:--");
+        zone->label_day = create_zone_label(row, &lv_font_montserrat_14, "---");
+
+        // Nothing is shown yet, and the offset is computed at the first update.
+        zone->shown_minute_of_day = -1;
+        zone->shown_weekday = -1;
+        zone->next_change = 0;
+    }
+    computed_minute = UINT32_MAX;
+
+    if (refresh_timer == NULL) {
+        refresh_timer = lv_timer_create(worldclock_refresh, WORLDCLOCK_REFRESH_MS, NULL);
+    }
+
+    lv_obj_add_event_cb(worldclock_screen, worldclock_screen_event, LV_EVENT_ALL, NULL);
+    LOG_DBG("World clock screen initialized successfully.");
+}
@@ -0,0 +1,30 @@
+/** World Clock Screen Interface.
+ * Provides the time and the weekday of a few time zones, updated every minute.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#ifndef _UI_SCREENS_WORLDCLOCK_H
+#define _UI_SCREENS_WORLDCLOCK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "lvgl.h"
+
+/* The screen object to be used in the userinterface. */
+extern lv_obj_t *worldclock_screen;
+
+/* The init implementation for the world clock screen. */
+void worldclock_screen_init();
+
+/* Event handler for the world clock screen gestures. */
+void worldclock_screen_event(lv_event_t * event);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
@@ -11,9 +11,31 @@
 #include <zephyr/logging/log.h>
 
 #include "userinterface/userinterface.h"
+#include "userinterface/renderstats.h"
+#include "userinterface/screenbench.h"
+#include "userinterface/automation.h"
+#include "userinterface/preload.h"
+#include "userinterface/ambient.h"
+#include "userinterface/mempools.h"
+#include "userinterface/construct.h"
+#include "userinterface/utils.h"
+#include "userinterface/screens/menu/menu.h"
+#include "userinterface/screens/blepairing/blepairing.h"
+#include "userinterface/screens/stephistory/stephistory.h"
+#include "userinterface/screens/worldclock/worldclock.h"
+#include "userinterface/screens/agenda/agenda.h"
+#include "benchmark/benchmark.h"
 #include "devicetwin/devicetwin.h"
+#include "simulation/simulation.h"
+#include "display/display.h"
+#include "touch/touch.h"
 
-LOG_MODULE_REGISTER(ZephyrWatch_UserInterface, LOG_LEVEL_INF);
+LOG_MODULE_REGISTER(ZephyrWatch_UserInterface, CONFIG_ZW_LOG_LEVEL);
+
+#if defined(CONFIG_ZW_LOG_CYCLE_STATS)
+// Cost of the log call in the date worker, which runs in the UI work queue.
+static BENCHMARK_METRIC_DEFINE(date_worker_log_cycles, "Date worker log call", "cycles");
+#endif
 
 // Define the timer callbacks' prototypes.
 static void update_clock_view_callback(struct k_timer *timer);
@@ -46,9 +68,24 @@ void user_interface_init() {
         LV_FONT_DEFAULT
     );
     lv_disp_set_theme(display, theme);
+
+    // Measure the render and flush performance if requested.
+    if (IS_ENABLED(CONFIG_ZW_RENDER_STATS)) {
+        render_stats_init(display);
+        render_stats_track_screen(&home_screen, "home");
+        if (IS_ENABLED(CONFIG_ZW_UI_MENU)) render_stats_track_screen(&menu_screen, "menu");
+        if (IS_ENABLED(CONFIG_ZW_UI_BLEPAIRING)) render_stats_track_screen(&blepairing_screen, "blepairing");
+        if (IS_ENABLED(CONFIG_ZW_UI_STEPHISTORY)) render_stats_track_screen(&stephistory_screen, "stephistory");
+        if (IS_ENABLED(CONFIG_ZW_UI_WORLDCLOCK)) render_stats_track_screen(&worldclock_screen, "worldclock");
+        if (IS_ENABLED(CONFIG_ZW_UI_AGENDA)) render_stats_track_screen(&agenda_screen, "agenda");
+    }
+
     home_screen_init();
     lv_disp_load_scr(home_screen);
 
+    // The agenda is built before the menu, it brings up the reminders.
+    if (IS_ENABLED(CONFIG_ZW_UI_AGENDA)) agenda_screen_init();
+
     // Create a seperate the UI work queue.
     k_work_queue_start(&ui_work_q, ui_stack_area, K_THREAD_STACK_SIZEOF(ui_stack_area),
                        K_PRIO_PREEMPT(5), NULL);
@@ -65,12 +102,61 @@ void user_interface_init() {
 
     k_work_submit_to_queue(&ui_work_q, &date_day_update_work);
     LOG_DBG("First update signal is send to clock updater.");
+
+    ui_construct_init();
+    if (IS_ENABLED(CONFIG_ZW_LVGL_MEM_POOLS)) {
+        ui_mem_pools_init();
+    }
+    if (IS_ENABLED(CONFIG_ZW_UI_PRELOAD)) {
+        ui_preload_init();
+    }
+    if (IS_ENABLED(CONFIG_ZW_UI_AMBIENT)) {
+        ui_ambient_init();
+    }
+    if (IS_ENABLED(CONFIG_ZW_UI_SCREEN_BENCH)) {
+        screen_bench_start();
+    }
+    if (IS_ENABLED(CONFIG_ZW_UI_AUTOMATION)) {
+        ui_automation_init(display);
+    }
+}
+
+/* DISPATCH_TOUCH_GESTURES
+ * Send the gestures recognized by the touch controller as LVGL events. The swipes go to the
+ * active screen, the double taps to the object under the finger.
+ */
+static void dispatch_touch_gestures() {
+    touch_gesture_t gesture;
+    while (touch_get_gesture(&gesture) == 0) {
+        lv_obj_t *screen = lv_screen_active();
+        switch (gesture.type) {
+        case TOUCH_GESTURE_SWIPE_UP: send_gesture(screen, LV_DIR_TOP); break;
+        case TOUCH_GESTURE_SWIPE_DOWN: send_gesture(screen, LV_DIR_BOTTOM); break;
+        case TOUCH_GESTURE_SWIPE_LEFT: send_gesture(screen, LV_DIR_LEFT); break;
+        case TOUCH_GESTURE_SWIPE_RIGHT: send_gesture(screen, LV_DIR_RIGHT); break;
+        case TOUCH_GESTURE_DOUBLE_TAP: {
+            lv_point_t point = { .x = gesture.x, .y = gesture.y };
+            lv_obj_t *target = lv_indev_search_obj(screen, &point);
+            lv_obj_send_event(target ? target : screen, LV_EVENT_DOUBLE_CLICKED, NULL);
+            break;
+        }
+        case TOUCH_GESTURE_WAKE:
+            enable_display_subsystem();
+            // Back to full colors with the quantization of the ambient display removed.
+            if (IS_ENABLED(CONFIG_ZW_UI_AMBIENT)) ui_display_mode_set(DISPLAY_MODE_FULL);
+            lv_display_trigger_activity(NULL);
+            break;
+        }
+    }
 }
 
 /* USER_INTERFACE_TASK_HANDLER
  * Call LVGLs task handler.
  */
 void user_interface_task_handler() {
+    if (IS_ENABLED(CONFIG_ZW_TOUCH)) {
+        dispatch_touch_gestures();
+    }
     lv_task_handler();
 }
 
@@ -105,6 +191,9 @@ static void update_clock_view_callback(struct k_timer *timer) {
 static void clock_update_worker(struct k_work *work) {
     // Get the device twin to use the latest information..
     device_twin_t* device_twin = get_device_twin_instance();
+    if (IS_ENABLED(CONFIG_ZW_SIMULATION)) {
+        simulation_note_wakeup(SIMULATION_WAKEUP_CLOCK_WORKER);
+    }
     LOG_DBG("Device's clock in UNIX epochs: %u", device_twin->unix_time);
 
     // Construct the local time from UNIX time and save it.
@@ -140,6 +229,13 @@ static void date_day_update_worker(struct k_work *work) {
     if (ret != 0) {
         LOG_ERR("Failed to update the date view.");
     }
+    if (IS_ENABLED(CONFIG_ZW_SIMULATION)) {
+        simulation_note_wakeup(SIMULATION_WAKEUP_DATE_WORKER);
+        simulation_note_date_shown(local_time.year, local_time.month, local_time.day);
+    }
+    BENCHMARK_LOG_CALL(date_worker_log_cycles,
+        LOG_INF("Date view updated to %04u-%02u-%02u.", local_time.year, local_time.month,
+                local_time.day));
     ret = home_screen_set_day(local_time.weekday);
     if (ret != 0) {
         LOG_ERR("Failed to update the day view.");
@@ -6,8 +6,19 @@
  * @maintainer electricalgorithm @ github
  */
 
+#include <zephyr/kernel.h>
+#include <zephyr/devicetree.h>
 #include "lvgl.h"
 
+#if defined(CONFIG_ZW_TOUCH) && DT_HAS_COMPAT_STATUS_OKAY(zephyr_lvgl_pointer_input)
+#include <lvgl_input_device.h>
+// The LVGL pointer of the CST816S, its gestures come from the controller instead.
+#define TOUCH_POINTER_NODE DT_COMPAT_GET_ANY_STATUS_OKAY(zephyr_lvgl_pointer_input)
+#endif
+
+// Direction of the gesture being sent by send_gesture().
+static lv_dir_t sent_gesture_dir;
+
 void remove_scrollable(lv_obj_t *obj) {
     // Remove the ability to scroll the object.
     lv_obj_remove_flag(obj, LV_OBJ_FLAG_SCROLLABLE);
@@ -79,4 +90,19 @@ lv_obj_t* create_row(lv_obj_t* root, uint8_t width_perc, uint8_t height_perc) {
 
     // Return the created row object.
     return row;
-}
\ No newline at end of file
+}
+void send_gesture(lv_obj_t *obj, lv_dir_t dir) {
+    sent_gesture_dir = dir;
+    lv_obj_send_event(obj, LV_EVENT_GESTURE, &sent_gesture_dir);
+}
+
+lv_dir_t get_gesture_dir(lv_event_t *event) {
+    // LVGL passes its input device as the parameter, the sent gestures their direction.
+    if (lv_event_get_param(event) == &sent_gesture_dir) return sent_gesture_dir;
+    lv_indev_t *indev = lv_indev_active();
+#if defined(TOUCH_POINTER_NODE)
+    // Only the touch pointer is ignored, the other input devices (e.g. the automation) keep theirs.
+    if (indev == lvgl_input_get_indev(DEVICE_DT_GET(TOUCH_POINTER_NODE))) return LV_DIR_NONE;
+#endif
+    return lv_indev_get_gesture_dir(indev);
+}
@@ -39,6 +39,21 @@ lv_obj_t* create_column(lv_obj_t* root, uint8_t width_perc, uint8_t height_perc)
  */
 lv_obj_t* create_row(lv_obj_t* root, uint8_t width_perc, uint8_t height_perc);
 
+/**
+ * Send a gesture recognized outside of LVGL to the object.
+ * @param obj The object to receive the LV_EVENT_GESTURE event.
+ * @param dir The direction of the gesture.
+ */
+void send_gesture(lv_obj_t *obj, lv_dir_t dir);
+
+/**
+ * Get the direction of a gesture event. With the touch subsystem, the gestures come from the
+ * touch controller and the ones LVGL computes from the touch points are ignored.
+ * @param event The LV_EVENT_GESTURE event.
+ * @return The direction of the gesture, or LV_DIR_NONE.
+ */
+lv_dir_t get_gesture_dir(lv_event_t *event);
+
 
 #ifdef __cplusplus
 }
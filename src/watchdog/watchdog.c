@@ -12,7 +12,7 @@
 #include "watchdog/watchdog.h"
 
 // Create a logger.
-LOG_MODULE_REGISTER(ZephyrWatch_Watchdog, LOG_LEVEL_INF);
+LOG_MODULE_REGISTER(ZephyrWatch_Watchdog, CONFIG_ZW_LOG_LEVEL);
 
 // Get the watchdog device using the project's aliases.
 #define WATCHDOG_DEVICE DT_ALIAS(watchdogdevice)
@@ -0,0 +1,434 @@
+/** BabbleSim central for the ZephyrWatch BLE benchmarks.
+ * Finds the watch by the Current Time Service UUID in its advertisement, pairs with the fixed
+ * passkey and writes the current time characteristic several times per connection. Then it
+ * downloads the activity history through the export service, acknowledging every batch like a
+ * phone. It measures the connection, pairing, CTS write and reconnect latencies and the
+ * notification throughput on the simulated radio, so the numbers are the same from one run to
+ * the other.
+ *
+ * @license GNU v3
+ * @maintainer electricalgorithm @ github
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <posix_board_if.h>
+
+LOG_MODULE_REGISTER(ZephyrWatch_BsimCentral, LOG_LEVEL_INF);
+
+#define STEP_TIMEOUT K_SECONDS(30)
+
+// Export service of the watch, see README.
+#define BT_UUID_EXPORT_CONTROL \
+    BT_UUID_DECLARE_128(BT_UUID_128_ENCODE(0x7a770002, 0x5a57, 0x4e8a, 0x9c1e, 0x3f2b6d0a1c00))
+#define BT_UUID_EXPORT_DATA \
+    BT_UUID_DECLARE_128(BT_UUID_128_ENCODE(0x7a770003, 0x5a57, 0x4e8a, 0x9c1e, 0x3f2b6d0a1c00))
+#define EXPORT_CMD_START 0x01
+#define EXPORT_CMD_ACK 0x02
+#define EXPORT_BATCH_HEADER_LENGTH 9
+
+/* Min/max/average of a measurement. */
+typedef struct {
+    const char *name;
+    const char *unit;
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+} measurement_t;
+
+static measurement_t connect_time = { "Connection setup", "ms", .min = UINT32_MAX };
+static measurement_t pairing_time = { "Pairing", "ms", .min = UINT32_MAX };
+static measurement_t encryption_time = { "Re-encryption with the bond", "ms", .min = UINT32_MAX };
+static measurement_t reconnect_time = { "Reconnect after disconnection", "ms", .min = UINT32_MAX };
+static measurement_t discovery_time = { "GATT discovery after connection", "ms", .min = UINT32_MAX };
+static measurement_t write_latency = { "CTS write latency", "us", .min = UINT32_MAX };
+static measurement_t export_throughput = { "Export notification throughput", "B/s", .min = UINT32_MAX };
+static measurement_t export_record_rate = { "Export record rate", "records/s", .min = UINT32_MAX };
+
+// The watch and the state of the connection.
+static bt_addr_le_t watch_addr;
+static struct bt_conn *watch_conn;
+static uint16_t time_value_handle;
+static uint16_t export_control_handle;
+static uint16_t export_data_handle;
+static uint8_t step_error;
+
+// Database Hash of the watch when the handles were discovered, and the one read on connection.
+static uint8_t discovered_db_hash[16];
+static uint8_t db_hash[16];
+static bool db_hash_read;
+
+// State of the export being downloaded. The notifications come in the BT RX thread, the
+// acknowledgements are written from the system work queue.
+static uint32_t export_next_seq;
+static uint32_t export_bytes;
+static uint32_t export_records;
+static void export_ack_worker(struct k_work *work);
+static K_WORK_DEFINE(export_ack_work, export_ack_worker);
+
+static K_SEM_DEFINE(found_sem, 0, 1);
+static K_SEM_DEFINE(connected_sem, 0, 1);
+static K_SEM_DEFINE(security_sem, 0, 1);
+static K_SEM_DEFINE(discovered_sem, 0, 1);
+static K_SEM_DEFINE(hash_sem, 0, 1);
+static K_SEM_DEFINE(written_sem, 0, 1);
+static K_SEM_DEFINE(disconnected_sem, 0, 1);
+static K_SEM_DEFINE(mtu_sem, 0, 1);
+static K_SEM_DEFINE(subscribed_sem, 0, 1);
+static K_SEM_DEFINE(acked_sem, 0, 1);
+static K_SEM_DEFINE(export_done_sem, 0, 1);
+
+/* MEASUREMENT_RECORD
+ * Add a sample to the measurement.
+ */
+static void measurement_record(measurement_t *measurement, uint32_t value) {
+    measurement->count++;
+    measurement->sum += value;
+    if (value < measurement->min) measurement->min = value;
+    if (value > measurement->max) measurement->max = value;
+}
+
+/* MEASUREMENT_REPORT
+ * Print the measurement in the same format as the benchmark subsystem of the watch.
+ */
+static void measurement_report(const measurement_t *measurement) {
+    if (measurement->count == 0) return;
+    LOG_INF("%s: n=%u min=%u avg=%u max=%u %s", measurement->name, measurement->count,
+            measurement->min, (uint32_t)(measurement->sum / measurement->count),
+            measurement->max, measurement->unit);
+}
+
+/* WAIT_FOR
+ * Wait for a step of the benchmark, stop the simulation if it does not happen.
+ */
+static void wait_for(struct k_sem *sem, const char *step) {
+    if (k_sem_take(sem, STEP_TIMEOUT) != 0 || step_error) {
+        LOG_ERR("Benchmark failed while waiting for %s (err %u).", step, step_error);
+        posix_exit(1);
+    }
+}
+
+static bool advertises_cts(struct bt_data *data, void *user_data) {
+    bool *found = user_data;
+    if (data->type != BT_DATA_UUID16_ALL && data->type != BT_DATA_UUID16_SOME) return true;
+    for (uint8_t i = 0; i + 1 < data->data_len; i += 2) {
+        if (sys_get_le16(&data->data[i]) == BT_UUID_CTS_VAL) {
+            *found = true;
+            return false;
+        }
+    }
+    return true;
+}
+
+static void process_device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type, struct net_buf_simple *ad) {
+    bool found = false;
+    if (type != BT_GAP_ADV_TYPE_ADV_IND) return;
+    bt_data_parse(ad, advertises_cts, &found);
+    if (!found || bt_le_scan_stop() != 0) return;
+    bt_addr_le_copy(&watch_addr, addr);
+    k_sem_give(&found_sem);
+}
+
+static void process_connection(struct bt_conn *conn, uint8_t err) {
+    step_error = err;
+    k_sem_give(&connected_sem);
+}
+
+static void process_disconnection(struct bt_conn *conn, uint8_t reason) {
+    bt_conn_unref(watch_conn);
+    watch_conn = NULL;
+    // A phone without a Database Hash forgets the handles with the connection.
+    if (!db_hash_read) {
+        time_value_handle = export_control_handle = export_data_handle = 0;
+    }
+    k_sem_give(&disconnected_sem);
+}
+
+static void process_security_changed(struct bt_conn *conn, bt_security_t level, enum bt_security_err err) {
+    step_error = err;
+    k_sem_give(&security_sem);
+}
+
+BT_CONN_CB_DEFINE(connection_callbacks) = {
+    .connected = process_connection,
+    .disconnected = process_disconnection,
+    .security_changed = process_security_changed,
+};
+
+static void process_passkey_entry(struct bt_conn *conn) {
+    bt_conn_auth_passkey_entry(conn, CONFIG_BSIM_CENTRAL_PASSKEY);
+}
+
+static void process_auth_cancel(struct bt_conn *conn) {
+    LOG_ERR("Pairing cancelled by the watch.");
+}
+
+static struct bt_conn_auth_cb auth_callbacks = {
+    .passkey_entry = process_passkey_entry,
+    .cancel = process_auth_cancel,
+};
+
+static uint16_t *discovered_handle;
+
+static uint8_t process_discovery(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                                 struct bt_gatt_discover_params *params) {
+    if (attr != NULL) {
+        const struct bt_gatt_chrc *chrc = attr->user_data;
+        *discovered_handle = chrc->value_handle;
+    }
+    k_sem_give(&discovered_sem);
+    return BT_GATT_ITER_STOP;
+}
+
+static void process_write(struct bt_conn *conn, uint8_t err, struct bt_gatt_write_params *params) {
+    step_error = err;
+    k_sem_give(&written_sem);
+}
+
+/* DISCOVER_CHARACTERISTIC
+ * Find the value handle of a characteristic, 0 if the watch has none.
+ */
+static uint16_t discover_characteristic(const struct bt_uuid *uuid, const char *step) {
+    static struct bt_gatt_discover_params discover_params = {
+        .func = process_discovery,
+        .type = BT_GATT_DISCOVER_CHARACTERISTIC,
+    };
+    uint16_t handle = 0;
+
+    discovered_handle = &handle;
+    discover_params.uuid = uuid;
+    discover_params.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+    discover_params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+    step_error = bt_gatt_discover(watch_conn, &discover_params);
+    wait_for(&discovered_sem, step);
+    return handle;
+}
+
+static uint8_t process_hash_read(struct bt_conn *conn, uint8_t err, struct bt_gatt_read_params *params,
+                                 const void *data, uint16_t length) {
+    if (err == 0 && data != NULL && length == sizeof(db_hash)) {
+        memcpy(db_hash, data, sizeof(db_hash));
+        db_hash_read = true;
+    }
+    k_sem_give(&hash_sem);
+    return BT_GATT_ITER_STOP;
+}
+
+/* READ_DATABASE_HASH
+ * Read the Database Hash of the watch. A watch built without the GATT caching has none, and
+ * its handles have to be discovered on every connection.
+ */
+static void read_database_hash() {
+    static struct bt_gatt_read_params read_params = {
+        .func = process_hash_read,
+        .handle_count = 0,
+        .by_uuid.uuid = BT_UUID_GATT_DB_HASH,
+    };
+
+    db_hash_read = false;
+    read_params.by_uuid.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+    read_params.by_uuid.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+    step_error = bt_gatt_read(watch_conn, &read_params);
+    wait_for(&hash_sem, "the Database Hash");
+}
+
+/* DISCOVER_HANDLES
+ * Find the characteristics of the benchmark, unless the Database Hash is the same as when they
+ * were discovered. That is the GATT caching of a bonded phone.
+ */
+static void discover_handles() {
+    read_database_hash();
+    if (time_value_handle != 0 && db_hash_read && memcmp(db_hash, discovered_db_hash, sizeof(db_hash)) == 0) {
+        return;
+    }
+
+    time_value_handle = discover_characteristic(BT_UUID_CTS_CURRENT_TIME, "the CTS discovery");
+    if (time_value_handle == 0) {
+        LOG_ERR("The watch has no current time characteristic.");
+        posix_exit(1);
+    }
+    export_control_handle = discover_characteristic(BT_UUID_EXPORT_CONTROL, "the export discovery");
+    export_data_handle = discover_characteristic(BT_UUID_EXPORT_DATA, "the export discovery");
+    memcpy(discovered_db_hash, db_hash, sizeof(db_hash));
+}
+
+/* WRITE_CURRENT_TIME
+ * Write the time with a response and measure the round trip.
+ */
+static void write_current_time(uint32_t unix_time) {
+    static uint8_t value[sizeof(uint32_t)];
+    static struct bt_gatt_write_params write_params = {
+        .func = process_write,
+        .data = value,
+        .length = sizeof(value),
+    };
+
+    sys_put_le32(unix_time, value);
+    write_params.handle = time_value_handle;
+
+    uint32_t start_cycles = k_cycle_get_32();
+    step_error = bt_gatt_write(watch_conn, &write_params);
+    wait_for(&written_sem, "the CTS write");
+    measurement_record(&write_latency, k_cyc_to_us_floor32(k_cycle_get_32() - start_cycles));
+}
+
+static void process_mtu_exchange(struct bt_conn *conn, uint8_t err, struct bt_gatt_exchange_params *params) {
+    step_error = err;
+    k_sem_give(&mtu_sem);
+}
+
+static void process_subscription(struct bt_conn *conn, uint8_t err, struct bt_gatt_subscribe_params *params) {
+    step_error = err;
+    k_sem_give(&subscribed_sem);
+}
+
+static void process_ack_write(struct bt_conn *conn, uint8_t err, struct bt_gatt_write_params *params) {
+    k_sem_give(&acked_sem);
+}
+
+/* PROCESS_EXPORT_DATA
+ * Count a batch and acknowledge the records in it. A batch with no records ends the export.
+ */
+static uint8_t process_export_data(struct bt_conn *conn, struct bt_gatt_subscribe_params *params,
+                                   const void *data, uint16_t length) {
+    const uint8_t *batch = data;
+    if (data == NULL || length < EXPORT_BATCH_HEADER_LENGTH) return BT_GATT_ITER_CONTINUE;
+
+    export_bytes += length;
+    if (batch[8] == 0) {
+        k_sem_give(&export_done_sem);
+        return BT_GATT_ITER_CONTINUE;
+    }
+    export_records += batch[8];
+    export_next_seq = sys_get_le32(batch) + batch[8];
+    k_work_submit(&export_ack_work);
+    return BT_GATT_ITER_CONTINUE;
+}
+
+/* EXPORT_ACK_WORKER
+ * Acknowledge up to the last received batch. The batches received during a write are
+ * acknowledged together by the next one.
+ */
+static void export_ack_worker(struct k_work *work) {
+    static uint8_t value[1 + sizeof(uint32_t)] = { EXPORT_CMD_ACK };
+    static struct bt_gatt_write_params ack_params = {
+        .func = process_ack_write,
+        .data = value,
+        .length = sizeof(value),
+    };
+
+    sys_put_le32(export_next_seq, value + 1);
+    ack_params.handle = export_control_handle;
+    if (bt_gatt_write(watch_conn, &ack_params) == 0) {
+        k_sem_take(&acked_sem, STEP_TIMEOUT);
+    }
+}
+
+/* RUN_EXPORT
+ * Download the whole history kept by the watch and measure the notification throughput, from
+ * the START write to the end batch.
+ */
+static void run_export() {
+    static struct bt_gatt_exchange_params mtu_params = { .func = process_mtu_exchange };
+    static struct bt_gatt_subscribe_params subscribe_params = {
+        .notify = process_export_data,
+        .subscribe = process_subscription,
+        .value = BT_GATT_CCC_NOTIFY,
+    };
+    static uint8_t start[1 + sizeof(uint32_t)] = { EXPORT_CMD_START };
+    static struct bt_gatt_write_params start_params = {
+        .func = process_write,
+        .data = start,
+        .length = sizeof(start),
+    };
+
+    // The batches are sized to the MTU, it is exchanged once per connection.
+    if (bt_gatt_exchange_mtu(watch_conn, &mtu_params) == 0) {
+        wait_for(&mtu_sem, "the MTU exchange");
+    }
+
+    // The CCC descriptor follows the data characteristic value.
+    subscribe_params.value_handle = export_data_handle;
+    subscribe_params.ccc_handle = export_data_handle + 1;
+    step_error = bt_gatt_subscribe(watch_conn, &subscribe_params);
+    wait_for(&subscribed_sem, "the export subscription");
+
+    // From record 0: the watch starts from the oldest record it keeps.
+    export_bytes = export_records = 0;
+    start_params.handle = export_control_handle;
+    uint32_t start_cycles = k_cycle_get_32();
+    step_error = bt_gatt_write(watch_conn, &start_params);
+    wait_for(&written_sem, "the export start");
+    wait_for(&export_done_sem, "the end of the export");
+
+    uint32_t elapsed_us = MAX(k_cyc_to_us_floor32(k_cycle_get_32() - start_cycles), 1);
+    measurement_record(&export_throughput, (uint32_t)((uint64_t)export_bytes * USEC_PER_SEC / elapsed_us));
+    measurement_record(&export_record_rate, (uint32_t)((uint64_t)export_records * USEC_PER_SEC / elapsed_us));
+    LOG_INF("Export of %u records in %u bytes took %u ms.", export_records, export_bytes, elapsed_us / 1000);
+    bt_gatt_unsubscribe(watch_conn, &subscribe_params);
+}
+
+int main(void) {
+    int64_t disconnected_at_ms = 0;
+    uint32_t unix_time = 1767218400;
+
+    if (bt_enable(NULL) != 0 || bt_conn_auth_cb_register(&auth_callbacks) != 0) {
+        LOG_ERR("Bluetooth init failed.");
+        posix_exit(1);
+    }
+
+    for (int round = 0; round < CONFIG_BSIM_CENTRAL_ROUNDS; round++) {
+        // Find the watch and connect.
+        step_error = bt_le_scan_start(BT_LE_SCAN_PASSIVE, process_device_found);
+        wait_for(&found_sem, "the advertisement");
+
+        int64_t start_ms = k_uptime_get();
+        step_error = bt_conn_le_create(&watch_addr, BT_CONN_LE_CREATE_CONN, BT_LE_CONN_PARAM_DEFAULT, &watch_conn);
+        wait_for(&connected_sem, "the connection");
+        int64_t now_ms = k_uptime_get();
+        measurement_record(&connect_time, (uint32_t)(now_ms - start_ms));
+        if (disconnected_at_ms) {
+            measurement_record(&reconnect_time, (uint32_t)(now_ms - disconnected_at_ms));
+        }
+
+        // CTS writes need an authenticated link: pairing for the first time, then the bond.
+        start_ms = now_ms;
+        step_error = bt_conn_set_security(watch_conn, BT_SECURITY_L3);
+        wait_for(&security_sem, "the security");
+        measurement_record(round == 0 ? &pairing_time : &encryption_time, (uint32_t)(k_uptime_get() - start_ms));
+
+        start_ms = k_uptime_get();
+        discover_handles();
+        measurement_record(&discovery_time, (uint32_t)(k_uptime_get() - start_ms));
+        for (int write = 0; write < CONFIG_BSIM_CENTRAL_WRITES; write++) {
+            write_current_time(unix_time++);
+        }
+        if (IS_ENABLED(CONFIG_BSIM_CENTRAL_EXPORT) && export_control_handle && export_data_handle) {
+            run_export();
+        }
+
+        step_error = bt_conn_disconnect(watch_conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+        wait_for(&disconnected_sem, "the disconnection");
+        disconnected_at_ms = k_uptime_get();
+    }
+
+    measurement_report(&connect_time);
+    measurement_report(&pairing_time);
+    measurement_report(&encryption_time);
+    measurement_report(&reconnect_time);
+    measurement_report(&discovery_time);
+    measurement_report(&write_latency);
+    measurement_report(&export_throughput);
+    measurement_report(&export_record_rate);
+
+    LOG_PANIC();
+    posix_exit(0);
+    return 0;
+}